@@ -42,7 +42,7 @@
 unsigned int
 WordToHost(unsigned int word) {
 #ifdef HOST_IS_BIG_ENDIAN
-	 register unsigned long result;
+	 register unsigned int result;
 	 result = (word >> 24) & 0x000000ff;
 	 result |= (word >> 8) & 0x0000ff00;
 	 result |= (word << 8) & 0x00ff0000;
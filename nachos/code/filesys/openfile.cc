@@ -28,6 +28,7 @@ OpenFile::OpenFile(int sector)
 { 
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    hdrSector = sector;
     seekPosition = 0;
 }
 
@@ -192,3 +193,14 @@ OpenFile::Length()
 { 
     return hdr->FileLength(); 
 }
+
+//----------------------------------------------------------------------
+// OpenFile::SameFile
+// 	Return TRUE if "other" is open on the same file as we are.
+//----------------------------------------------------------------------
+
+bool
+OpenFile::SameFile(OpenFile *other)
+{
+    return hdrSector == other->hdrSector;
+}
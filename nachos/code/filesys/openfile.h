@@ -28,10 +28,17 @@
 					// See definitions listed under #else
 class OpenFile {
   public:
-    OpenFile(int f) { file = f; currentOffset = 0; }	// open the file
-    ~OpenFile() { Close(file); }			// close the file
+    OpenFile(int f) { file = f; currentOffset = 0; mapping = NULL; }
+							// open the file
+    ~OpenFile() { 					// close the file
+		if (mapping != NULL)
+		    UnmapFile(mapping, mappedLength);
+		Close(file);
+		}
 
     int ReadAt(char *into, int numBytes, int position) { 
+		if (mapping != NULL)
+		    return ReadMapped(into, numBytes, position);
     		Lseek(file, position, 0); 
 		return ReadPartial(file, into, numBytes); 
 		}	
@@ -52,10 +59,33 @@ class OpenFile {
 		}
 
     int Length() { Lseek(file, 0, 2); return Tell(file); }
+    bool SameFile(OpenFile *other) { return ::SameFile(file, other->file); }
+
+    // From now on, read the file from a mapping of it, rather than with
+    // a system call each time.  For program files, which aren't written
+    // to while they are open.
+    void MapForReading() {
+		if (mapping == NULL) {
+		    mappedLength = Length();
+		    mapping = MapFile(file, mappedLength);
+		}
+		}
     
   private:
     int file;
     int currentOffset;
+    char *mapping;			// the file, mapped into memory, or
+					// NULL if it isn't
+    int mappedLength;			// ... and how much of it
+
+    int ReadMapped(char *into, int numBytes, int position) {
+		if ((position < 0) || (position >= mappedLength))
+		    return 0;
+		if (numBytes > mappedLength - position)
+		    numBytes = mappedLength - position;
+		bcopy(mapping + position, into, numBytes);
+		return numBytes;
+		}
 };
 
 #else // FILESYS
@@ -85,9 +115,12 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    bool SameFile(OpenFile *other);	// is "other" open on the same file?
     
   private:
     FileHeader *hdr;			// Header for this file 
+    int hdrSector;			// ... and where it is on disk
     int seekPosition;			// Current position within the file
 };
 
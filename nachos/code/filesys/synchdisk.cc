@@ -24,7 +24,7 @@
 //----------------------------------------------------------------------
 
 static void
-DiskRequestDone (int arg)
+DiskRequestDone (intptr_t arg)
 {
     SynchDisk* disk = (SynchDisk *)arg;
 
@@ -44,7 +44,7 @@ SynchDisk::SynchDisk(char* name)
 {
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, (int) this);
+    disk = new Disk(name, DiskRequestDone, (intptr_t) this);
 }
 
 //----------------------------------------------------------------------
@@ -96,6 +96,36 @@ SynchDisk::WriteSector(int sectorNumber, char* data)
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchDisk::Latency
+// 	Return how long a request for a sector would take, if it were
+//	sent to the disk now, so that a caller with several sectors to
+//	transfer can choose which to ask for first.
+//
+//	"sectorNumber" -- the disk sector
+//	"writing" -- TRUE for a write, which the track buffer can't speed up
+//----------------------------------------------------------------------
+
+int
+SynchDisk::Latency(int sectorNumber, bool writing)
+{
+    return disk->ComputeLatency(sectorNumber, writing);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Prefer
+// 	Let a thread have the disk ahead of the others waiting for it:
+//	see Lock::Prefer.
+//
+//	"thread" -- the thread to prefer
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Prefer(NachOSThread *thread)
+{
+    lock->Prefer(thread);
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
 // 	Disk interrupt handler.  Wake up any thread waiting for the disk
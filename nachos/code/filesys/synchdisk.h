@@ -37,6 +37,14 @@ class SynchDisk {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+
+    int Latency(int sectorNumber, bool writing);
+					// How long a request to read or write
+					// the sector would take, if it were
+					// made now
+
+    void Prefer(NachOSThread *thread);	// let "thread" have the disk next
+					// whenever it is waiting for it
     
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
@@ -0,0 +1,563 @@
+// blockcache.cc
+//	Routines to profile, decode and run hot blocks of user code.
+//	See blockcache.h for an overview.
+//
+//	A cached block is simply an array of pre-decoded instructions,
+//	which are run by Machine::ExecuteInstruction -- the same routine
+//	the interpreter uses -- so branch delay slots, delayed loads and
+//	exceptions behave exactly as they do in the interpreter.  What we
+//	save is the fetch, address translation and decode of every
+//	instruction, and the interrupt check after every tick.
+//
+//	Nothing is compiled to host code.  Since x86-64 became a
+//	supported host, that isn't for want of a 64-bit build; but a code
+//	generator would be needed for each host switch.s supports, would
+//	need writable, executable memory, and would have to reproduce the
+//	interpreter's delayed loads and exceptions itself, where sharing
+//	ExecuteInstruction keeps them right by construction.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "blockcache.h"
+#include "mipssim.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// IsControlTransfer, IsTrap
+// 	Classify decoded instructions for block formation.  A control
+//	transfer ends a block (after its delay slot); a trap can't be
+//	part of a block at all, since it always goes to the kernel.
+//----------------------------------------------------------------------
+
+static bool
+IsControlTransfer(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ: case OP_BNE: case OP_BGEZ: case OP_BGEZAL:
+      case OP_BGTZ: case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL:
+      case OP_J: case OP_JAL: case OP_JALR: case OP_JR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+static bool
+IsTrap(int opCode)
+{
+    return (opCode == OP_SYSCALL) || (opCode == OP_UNIMP)
+				|| (opCode == OP_RES);
+}
+
+//----------------------------------------------------------------------
+// Fuse
+// 	Decide whether the instructions "first" and "second" (which
+//	follow each other in a block) can be run as a superinstruction.
+//	We never fuse anything that writes r0, so that the pair can't
+//	depend on DelayedLoad clearing it in between.
+//----------------------------------------------------------------------
+
+static FusionType
+Fuse(Instruction *first, Instruction *second)
+{
+    int reg;
+
+    switch (first->opCode) {
+      case OP_LUI:
+	reg = first->rt;
+	if ((reg == 0) || (second->rs != reg))
+	    return NotFused;
+	if (((second->opCode == OP_ORI) || (second->opCode == OP_ADDIU))
+		&& (second->rt != 0))
+	    return FuseConstant;
+	if (second->opCode == OP_LW)
+	    return FuseAddressLoad;
+	return NotFused;
+
+      case OP_SLT: case OP_SLTU:
+	reg = first->rd;
+	break;
+      case OP_SLTI: case OP_SLTIU:
+	reg = first->rt;
+	break;
+      default:
+	return NotFused;
+    }
+    if ((reg != 0) && ((second->opCode == OP_BEQ) || (second->opCode == OP_BNE))
+	    && (((second->rs == reg) && (second->rt == 0))
+		|| ((second->rs == 0) && (second->rt == reg))))
+	return FuseCompareBranch;
+    return NotFused;
+}
+
+//----------------------------------------------------------------------
+// Fetch
+// 	Decode the instruction at physical address "physAddr".
+//----------------------------------------------------------------------
+
+static void
+Fetch(Instruction *instr, int physAddr)
+{
+    unsigned int word;
+
+    memcpy(&word, &machine->mainMemory[physAddr], sizeof(word));
+    instr->value = WordToHost(word);
+    instr->Decode();
+}
+
+//----------------------------------------------------------------------
+// CachedBlock::CachedBlock, ~CachedBlock
+// 	Set up and tear down an entry in the block cache.
+//----------------------------------------------------------------------
+
+CachedBlock::CachedBlock(int phys)
+{
+    physAddr = phys;
+    execCount = 0;
+    length = 0;
+    uncacheable = FALSE;
+    code = NULL;
+    fusion = NULL;
+    chain[0] = chain[1] = NULL;
+    nextChain = 0;
+    next = NULL;
+}
+
+CachedBlock::~CachedBlock()
+{
+    if (code != NULL)
+	delete [] code;
+    if (fusion != NULL)
+	delete [] fusion;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::BlockCache
+// 	Initialize an empty block cache.
+//
+//	"threshold" -- # of times a block has to be entered before we
+//		bother decoding it
+//----------------------------------------------------------------------
+
+BlockCache::BlockCache(int threshold)
+{
+    int i;
+
+    hotThreshold = threshold;
+    buckets = new CachedBlock *[BlockHashSize];
+    for (i = 0; i < BlockHashSize; i++)
+	buckets[i] = NULL;
+    codePage = new bool[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+	codePage[i] = FALSE;
+    generation = 0;
+    retired = new List;
+    running = NULL;
+    current = NULL;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::~BlockCache
+// 	De-allocate the block cache.
+//----------------------------------------------------------------------
+
+BlockCache::~BlockCache()
+{
+    Flush();
+    FreeRetired();
+    delete retired;
+    delete [] buckets;
+    delete [] codePage;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Flush
+// 	Throw away every block in the cache, because cached code
+//	has been overwritten.  The blocks can't be deleted yet, since
+//	the store that caused this may have come from one of them.
+//----------------------------------------------------------------------
+
+void
+BlockCache::Flush()
+{
+    CachedBlock *block;
+    int i;
+
+    DEBUG('b', "Flushing cached blocks\n");
+    for (i = 0; i < BlockHashSize; i++) {
+	while (buckets[i] != NULL) {
+	    block = buckets[i];
+	    buckets[i] = block->next;
+	    retired->Append((void *)block);
+	}
+    }
+    for (i = 0; i < NumPhysPages; i++)
+	codePage[i] = FALSE;
+    generation++;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::FreeRetired
+// 	Delete the blocks thrown away by earlier calls to Flush.  Only
+//	called when we know no cached code is running.
+//----------------------------------------------------------------------
+
+void
+BlockCache::FreeRetired()
+{
+    while (!retired->IsEmpty())
+	delete (CachedBlock *) retired->Remove();
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Lookup
+// 	Find the cache entry for the block starting at physical address
+//	"physAddr", creating one if this is the first time we've seen it.
+//----------------------------------------------------------------------
+
+CachedBlock *
+BlockCache::Lookup(int physAddr)
+{
+    int bucket = (physAddr >> 2) % BlockHashSize;
+    CachedBlock *block;
+
+    for (block = buckets[bucket]; block != NULL; block = block->next)
+	if (block->physAddr == physAddr)
+	    return block;
+    block = new CachedBlock(physAddr);
+    block->next = buckets[bucket];
+    buckets[bucket] = block;
+    return block;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Build
+// 	Decode the instructions of a hot block, starting at its physical
+//	address and stopping after the delay slot of the first branch or
+//	jump.  We also stop (before the offending instruction) at a trap,
+//	at the end of the page, or once the block gets too long.  A
+//	branch is only included if its delay slot fits in the block.
+//
+//	Then pick out the pairs that can be fused, from left to right.
+//----------------------------------------------------------------------
+
+void
+BlockCache::Build(CachedBlock *block)
+{
+    Instruction *decoded = new Instruction[MaxBlockLength];
+    int addr = block->physAddr;
+    int pageEnd = (addr / PageSize + 1) * PageSize;
+    int n = 0, pairs = 0, i;
+
+    while ((n < MaxBlockLength) && (addr + n * 4 < pageEnd)) {
+	Fetch(&decoded[n], addr + n * 4);
+	if (IsTrap(decoded[n].opCode))
+	    break;
+	if (IsControlTransfer(decoded[n].opCode)) {
+	    if ((n + 1 < MaxBlockLength) && (addr + (n + 1) * 4 < pageEnd)) {
+		Fetch(&decoded[n + 1], addr + (n + 1) * 4);
+		if (!IsTrap(decoded[n + 1].opCode)
+			&& !IsControlTransfer(decoded[n + 1].opCode))
+		    n += 2;
+	    }
+	    break;
+	}
+	n++;
+    }
+
+    if (n == 0) {
+	block->uncacheable = TRUE;
+	delete [] decoded;
+	return;
+    }
+    block->code = new Instruction[n];
+    block->fusion = new char[n];
+    for (i = 0; i < n; i++) {
+	block->code[i] = decoded[i];
+	block->fusion[i] = NotFused;
+    }
+    block->length = n;
+    delete [] decoded;
+
+    for (i = 0; i + 1 < n; i++) {
+	block->fusion[i] = Fuse(&block->code[i], &block->code[i + 1]);
+	if (block->fusion[i] != NotFused) {
+	    pairs++;
+	    i++;
+	}
+    }
+
+    codePage[addr / PageSize] = TRUE;
+    stats->numBlocksCached++;
+    DEBUG('b', "Cached block at physical address 0x%x, %d instructions, "
+	"%d fused pairs\n", addr, n, pairs);
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Execute
+// 	Run a cached block from start to finish.  We only get here
+//	if no interrupt can come due before the end of the block, so
+//	Interrupt::OneTick would do nothing but advance the clock; so
+//	instead of doing the interpreter's bookkeeping for each
+//	instruction, we charge the thread and the clock for the whole
+//	block before starting.
+//
+//	A fused pair only runs as a superinstruction if no delayed load
+//	is pending when it starts (otherwise the load would land in the
+//	middle of the pair); if one is, we run the two halves separately.
+//
+//	If an instruction raises an exception, Settle takes back the
+//	charge for the rest of the block before the kernel sees the
+//	counts; when we find out, we finish the tick the way the
+//	interpreter does, and give up.  We also give up if the block
+//	stored into cached code.
+//
+//	Returns TRUE if the whole block was run.
+//----------------------------------------------------------------------
+
+bool
+BlockCache::Execute(CachedBlock *block)
+{
+    int length = block->length;
+    int gen = generation;
+    int i, n;
+    bool ok;
+
+    Charge(length, length);
+    running = block;
+    for (i = 0; i < length; i += n) {
+	current = &block->code[i];
+	if ((block->fusion[i] != NotFused)
+			&& (machine->registers[LoadReg] == 0)) {
+	    n = 2;
+	    stats->numFusedPairs++;
+	    ok = ExecutePair((FusionType) block->fusion[i], current);
+	} else {
+	    n = 1;
+	    ok = machine->ExecuteInstruction(current);
+	}
+	if (!ok) {
+	    ASSERT(running == NULL);		// Settle was called
+	    interrupt->OneTick();
+	    return FALSE;
+	}
+	if (generation != gen) {
+	    running = NULL;
+	    Charge(-(length - i - n), -(length - i - n));
+	    return FALSE;
+	}
+    }
+    running = NULL;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Charge
+// 	Account for user instructions run from cached code, as the
+//	interpreter's IncInstructionCount and OneTick would have.
+//	Negative numbers take back an earlier charge.
+//
+//	With a TLB, the interpreter's fetch of each of them would have
+//	been a TLB hit: Run found the block's page in the TLB, and only
+//	the kernel can take it out.  We count those hits here, so that
+//	the TLB statistics don't depend on whether blocks are cached.
+//
+//	"instrs" -- # of instructions run by the current thread
+//	"ticks" -- # of user ticks they took
+//----------------------------------------------------------------------
+
+void
+BlockCache::Charge(int instrs, int ticks)
+{
+    currentThread->AddInstructionCount(instrs);
+    stats->numCachedInstrs += instrs;
+    if (machine->tlb != NULL)
+	stats->numTLBHits += instrs;
+    stats->totalTicks += ticks * UserTick;
+    stats->userTicks += ticks * UserTick;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Settle
+// 	Called by Machine::RaiseException.  If the exception came from
+//	an instruction in a cached block, take back what Execute
+//	charged for the instructions after it, and for its own tick
+//	(the interpreter counts the faulting instruction, but only
+//	advances the clock for it after the exception is handled).
+//----------------------------------------------------------------------
+
+void
+BlockCache::Settle()
+{
+    int unrun;
+
+    if (running == NULL)
+	return;
+    unrun = running->length - (current - running->code) - 1;
+    Charge(-unrun, -(unrun + 1));
+    running = NULL;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::ExecutePair
+// 	Run a superinstruction: the instruction at "instr" and the one
+//	after it, with the same effect on the registers as running them
+//	one at a time through Machine::ExecuteInstruction.  No delayed
+//	load is pending, and since neither instruction is in a delay
+//	slot, NextPC is just PC + 4 on entry.
+//
+//	Only the load in a FuseAddressLoad pair can raise an exception;
+//	if it does, the first half must already be complete, just as in
+//	the interpreter, and "current" must point at the load for Settle.
+//
+//	Returns FALSE if the second instruction raised an exception.
+//----------------------------------------------------------------------
+
+bool
+BlockCache::ExecutePair(FusionType type, Instruction *instr)
+{
+    Instruction *second = instr + 1;
+    int *registers = machine->registers;
+    int nextPC = registers[NextPCReg];
+    int pcAfter = nextPC + 8;
+    int rs = instr->rs, rt = instr->rt, rd = instr->rd;
+    int rs2 = second->rs, rt2 = second->rt;	// as ints, to index with
+    int addr, value;
+    bool taken;
+
+    registers[LoadValueReg] = 0;	// as the first DelayedLoad would leave it
+    switch (type) {
+      case FuseConstant:
+	registers[rt] = instr->extra << 16;
+	if (second->opCode == OP_ORI)
+	    registers[rt2] = registers[rs2] | (second->extra & 0xffff);
+	else
+	    registers[rt2] = registers[rs2] + second->extra;
+	break;
+
+      case FuseCompareBranch:
+	switch (instr->opCode) {
+	  case OP_SLT:
+	    registers[rd] = (registers[rs] < registers[rt]) ? 1 : 0;
+	    break;
+	  case OP_SLTU:
+	    registers[rd] = ((unsigned) registers[rs]
+			     < (unsigned) registers[rt]) ? 1 : 0;
+	    break;
+	  case OP_SLTI:
+	    registers[rt] = (registers[rs] < instr->extra) ? 1 : 0;
+	    break;
+	  case OP_SLTIU:
+	    registers[rt] = ((unsigned) registers[rs]
+			     < (unsigned) instr->extra) ? 1 : 0;
+	    break;
+	}
+	taken = (registers[rs2] == registers[rt2]);
+	if (second->opCode == OP_BNE)
+	    taken = !taken;
+	if (taken)
+	    pcAfter = nextPC + 4 + IndexToAddr(second->extra);
+	break;
+
+      case FuseAddressLoad:
+	registers[rt] = instr->extra << 16;
+	registers[PrevPCReg] = registers[PCReg];	// first half done
+	registers[PCReg] = nextPC;
+	registers[NextPCReg] = nextPC + 4;
+	current = second;
+	addr = registers[rs2] + second->extra;
+	if (addr & 0x3) {
+	    machine->RaiseException(AddressErrorException, addr);
+	    return FALSE;
+	}
+	if (!machine->ReadMem(addr, 4, &value))
+	    return FALSE;
+	machine->DelayedLoad(rt2, value);
+	break;
+
+      default:
+	ASSERT(FALSE);
+    }
+
+    registers[PrevPCReg] = nextPC;
+    registers[PCReg] = nextPC + 4;
+    registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// BlockCache::Run
+// 	Called by Machine::Run whenever the PC is at the start of a
+//	basic block.  Count the entry, and run cached blocks from
+//	here on for as long as we can, chaining from each block to
+//	the next.
+//
+//	We return to the interpreter when we reach a block that isn't
+//	(yet) cached, when we are in the middle of a branch, when the
+//	PC can't be translated (the interpreter will raise the
+//	exception), when the next block might not finish before the next
+//	interrupt is due, and after any exception.
+//
+//	No kernel code runs between the blocks we run here, so the
+//	page table, the TLB and the pending interrupts can't change
+//	underneath us.  In particular, once we have translated an
+//	address on a virtual page, we can find the rest of the page
+//	without going through Machine::Translate again.
+//----------------------------------------------------------------------
+
+void
+BlockCache::Run()
+{
+    CachedBlock *block, *prev = NULL;
+    int pc, phys, deadline, i;
+    int lastPC = 0, lastPhys = 0;
+
+    FreeRetired();
+    deadline = interrupt->NextDueTime();
+    for (;;) {
+	pc = machine->registers[PCReg];
+	if (machine->registers[NextPCReg] != pc + 4)
+	    return;			// let the interpreter finish the branch
+
+	if ((prev != NULL) && ((unsigned) pc / PageSize
+				== (unsigned) lastPC / PageSize))
+	    phys = lastPhys + (pc - lastPC);
+	else if (machine->Translate(pc, &phys, 4, FALSE) != NoException)
+	    return;
+	else if (machine->tlb != NULL)
+	    stats->numTLBHits--;	// not a fetch: see Charge
+	lastPC = pc;
+	lastPhys = phys;
+
+	block = NULL;
+	if (prev != NULL) {
+	    for (i = 0; i < 2; i++)
+		if ((prev->chain[i] != NULL)
+				&& (prev->chain[i]->physAddr == phys))
+		    block = prev->chain[i];
+	    if (block == NULL) {
+		block = Lookup(phys);
+		prev->chain[prev->nextChain] = block;
+		prev->nextChain = 1 - prev->nextChain;
+	    }
+	} else
+	    block = Lookup(phys);
+
+	block->execCount++;
+	if (block->length == 0) {
+	    if (block->uncacheable || (block->execCount < hotThreshold))
+		return;
+	    Build(block);
+	    if (block->length == 0)
+		return;
+	}
+	if (stats->totalTicks + block->length * UserTick >= deadline)
+	    return;
+	if (!Execute(block))
+	    return;
+	prev = block;
+    }
+}
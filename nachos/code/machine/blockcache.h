@@ -0,0 +1,131 @@
+// blockcache.h
+//	Data structures for the pre-decoded block cache, which keeps hot
+//	blocks of user code decoded.
+//
+//	The simulator in mipssim.cc fetches, translates and decodes
+//	every user instruction it executes, and then checks for pending
+//	interrupts after each one.  Most user programs spend their time
+//	in a few small loops, so almost all of that work is repeated.
+//
+//	The block cache counts how many times each basic block is
+//	entered.  Once a block is "hot", its instructions are decoded
+//	once and kept in the cache; from then on the block is run
+//	straight out of the cache, by the interpreter's own execute step,
+//	and consecutive blocks are chained together without going back
+//	through the main simulation loop.  Nothing is compiled to host
+//	code: this is a threaded interpreter over pre-decoded blocks, not
+//	a binary translator.
+//
+//	A block is a run of instructions within one physical page, ending
+//	with a branch or jump plus its delay slot.  Blocks never contain
+//	a system call or an illegal instruction, and we fall back to the
+//	interpreter on any exception, or whenever the next interrupt is
+//	due before the end of the block, so the simulated time and
+//	instruction counts are exactly those of Machine::OneInstruction.
+//	Those counts are charged once per block, up front, and the part
+//	of the block that didn't run is taken back if we leave early.
+//
+//	While decoding a block, we also look for a few instruction pairs that
+//	the compiler emits all the time -- building a 32-bit constant
+//	(lui + ori/addiu), comparing and branching (slt + beq/bne), and
+//	loading a global (lui + lw) -- and "fuse" each into a single
+//	superinstruction that does the work of both without going
+//	through the interpreter twice.
+//
+//	Blocks are kept by physical address, and the decoded form does
+//	not depend on where the page is mapped, so a context switch does
+//	not have to touch the cache.  A store into a page holding
+//	cached code throws the whole cache away.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "list.h"
+
+#define BlockHashSize	1024	// # of buckets in the block cache
+#define MaxBlockLength	64	// longest block we will cache
+
+// The superinstructions: each replaces an instruction and the one
+// following it.
+
+enum FusionType { NotFused,
+		  FuseConstant,		// lui r; ori/addiu x, r, imm
+		  FuseCompareBranch,	// slt(i)(u) c; beq/bne c, r0
+		  FuseAddressLoad	// lui r; lw x, imm(r)
+};
+
+// The following class defines one entry in the block cache.  An
+// entry is created the first time the block cache sees a block start,
+// to count how often it is entered; the block itself is decoded
+// once the count reaches the threshold.
+
+class CachedBlock {
+  public:
+    CachedBlock(int phys);	// start profiling the block at "phys"
+    ~CachedBlock();
+
+    int physAddr;		// physical address of the first instruction
+    int execCount;		// # of times the block has been entered
+    int length;			// # of instructions, 0 if not yet decoded
+    bool uncacheable;		// TRUE if there is nothing we can cache
+    				// here (eg, the block starts with a syscall)
+    Instruction *code;		// the decoded instructions
+    char *fusion;		// for each instruction, the FusionType of
+				// the pair starting there
+
+    CachedBlock *chain[2];	// the last two blocks we went on to, so
+				// that loops can skip the hash lookup
+    int nextChain;		// which chain entry to replace next
+
+    CachedBlock *next;		// next entry in the same hash bucket
+};
+
+// The following class defines the block cache itself.  There is
+// one, owned by the Machine.
+
+class BlockCache {
+  public:
+    BlockCache(int threshold);		// cache blocks once entered
+					// "threshold" times
+    ~BlockCache();
+
+    void Run();				// run cached blocks starting
+					// at the current PC, for as long
+					// as it is safe to do so
+
+    void InvalidatePage(int physPage) 	// physical page "physPage" was
+	{ if (codePage[physPage]) Flush(); }	// written to
+    void Flush();			// throw away every cached block
+    void Settle();			// an exception was raised; fix up
+					// the counts if it was in a block
+
+  private:
+    CachedBlock *Lookup(int physAddr);	// find a block, creating an
+					// entry if it isn't there yet
+    void Build(CachedBlock *block);	// decode the block's instructions
+    bool Execute(CachedBlock *block);	// run a cached block;
+					// FALSE if it didn't run to the end
+    bool ExecutePair(FusionType type, Instruction *instr);
+					// run a superinstruction
+    void Charge(int instrs, int ticks);	// account for cached code
+    void FreeRetired();			// delete blocks thrown away by Flush
+
+    int hotThreshold;			// entries needed before caching
+    CachedBlock **buckets;		// the block cache
+    bool *codePage;			// TRUE for each physical page that
+					// cached code came from
+    int generation;			// incremented on every Flush
+    List *retired;			// blocks thrown away by Flush; they
+					// may still be running, so we
+					// delete them at the next Run
+    CachedBlock *running;		// block being run, or NULL
+    Instruction *current;		// instruction in it being run
+};
+
+#endif // BLOCKCACHE_H
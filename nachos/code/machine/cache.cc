@@ -0,0 +1,130 @@
+// cache.cc
+//	Routines to model a set-associative cache.  See cache.h.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "cache.h"
+#include "utility.h"
+
+//----------------------------------------------------------------------
+// Cache::Cache
+// 	Initialize an empty cache.
+//
+//	"debugName" -- text name, for debugging
+//	"numRows" -- the number of sets
+//	"associativity" -- the number of lines in each set
+//	"lineSize" -- bytes per line; must be a power of two
+//	"randomReplacement" -- if TRUE, a miss replaces a random line of
+//		its set; otherwise the least recently used one
+//----------------------------------------------------------------------
+
+Cache::Cache(char *debugName, int numRows, int associativity, int lineSize,
+	     bool randomReplacement)
+{
+    ASSERT((numRows > 0) && (associativity > 0) && (lineSize > 0));
+    ASSERT((lineSize & (lineSize - 1)) == 0);
+
+    name = debugName;
+    rows = numRows;
+    ways = associativity;
+    for (lineShift = 0; (1 << lineShift) < lineSize; lineShift++)
+	;
+    random = randomReplacement;
+    tags = new int[rows * ways];
+    lastUsed = new int[rows * ways];
+    for (int i = 0; i < rows * ways; i++) {
+	tags[i] = -1;
+	lastUsed[i] = 0;
+    }
+    clock = 0;
+    seed = 1;
+}
+
+Cache::~Cache()
+{
+    delete [] tags;
+    delete [] lastUsed;
+}
+
+//----------------------------------------------------------------------
+// Cache::Access
+// 	Look up the line holding physical address "physAddr".  On a miss,
+//	the line replaces one in its set.  Returns TRUE on a hit.
+//----------------------------------------------------------------------
+
+bool
+Cache::Access(int physAddr)
+{
+    int line = physAddr >> lineShift;
+    int *tag = &tags[(line % rows) * ways];
+    int *used = &lastUsed[(line % rows) * ways];
+    int i, victim;
+
+    clock++;
+    for (i = 0; i < ways; i++)
+	if (tag[i] == line) {
+	    used[i] = clock;
+	    return TRUE;
+	}
+
+    if (random) {
+	seed = seed * 1103515245 + 12345;
+	victim = (seed >> 16) % ways;
+    } else {
+	victim = 0;
+	for (i = 1; i < ways; i++)
+	    if (used[i] < used[victim])	// empty lines were never used,
+		victim = i;		// so they go first
+    }
+    DEBUG('c', "%s miss at 0x%x\n", name, physAddr);
+    tag[victim] = line;
+    used[victim] = clock;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Cache::Checkpoint
+// 	Save which lines are present, and when each was last used, in the
+//	checkpoint file "fd".
+//----------------------------------------------------------------------
+
+void
+Cache::Checkpoint(int fd)
+{
+    int shape[4] = { rows, ways, lineShift, random };
+
+    WriteFile(fd, (char *)shape, sizeof(shape));
+    WriteFile(fd, (char *)tags, rows * ways * sizeof(int));
+    WriteFile(fd, (char *)lastUsed, rows * ways * sizeof(int));
+    WriteFile(fd, (char *)&clock, sizeof(clock));
+    WriteFile(fd, (char *)&seed, sizeof(seed));
+}
+
+//----------------------------------------------------------------------
+// Cache::Restore
+// 	Read back the contents saved by Checkpoint.  The cache must have
+//	been built with the same shape as the one that was saved.
+//----------------------------------------------------------------------
+
+void
+Cache::Restore(int fd)
+{
+    int shape[4];
+
+    Read(fd, (char *)shape, sizeof(shape));
+    if ((shape[0] != rows) || (shape[1] != ways) || (shape[2] != lineShift)
+		|| (shape[3] != random)) {
+	fprintf(stderr, "%s: checkpoint was taken with a different cache\n",
+		name);
+	Abort();
+    }
+    Read(fd, (char *)tags, rows * ways * sizeof(int));
+    Read(fd, (char *)lastUsed, rows * ways * sizeof(int));
+    Read(fd, (char *)&clock, sizeof(clock));
+    Read(fd, (char *)&seed, sizeof(seed));
+}
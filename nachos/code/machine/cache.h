@@ -0,0 +1,57 @@
+// cache.h
+//	Data structures to model a first-level cache.
+//
+//	Normally every user memory access takes the same time.  To study
+//	how a program's layout affects its running time, the machine can
+//	be given an instruction cache and a data cache (-ic and -dc), in
+//	the style of the knobs in bin/main.c: some number of rows (sets),
+//	each holding "associativity" lines of "lineSize" bytes, replaced
+//	either least-recently-used or at random.
+//
+//	We only model which lines are present, not their contents: the
+//	data always comes from mainMemory.  The cache is indexed by
+//	physical address, so it doesn't need flushing on a context switch.
+//	Each miss costs CacheMissTicks extra (see stats.h).
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "copyright.h"
+
+// The following class defines one cache.
+
+class Cache {
+  public:
+    Cache(char *debugName, int numRows, int associativity, int lineSize,
+	  bool randomReplacement);	// initialize an empty cache
+    ~Cache();
+
+    bool Access(int physAddr);		// look up the line holding
+					// "physAddr", bringing it in if
+					// it isn't there; TRUE on a hit
+
+    void Checkpoint(int fd);		// save the contents in a checkpoint
+    void Restore(int fd);		// and read them back
+
+  private:
+    char *name;				// for debugging
+    int rows;				// # of sets
+    int ways;				// lines in each set
+    int lineShift;			// log2 of the line size
+    bool random;			// replace at random, instead of
+					// the least recently used line
+    int *tags;				// line address held in each way of
+					// each row, or -1 if empty
+    int *lastUsed;			// when each way was last accessed
+    int clock;				// # of accesses so far
+    unsigned int seed;			// for random replacement; our own,
+					// so as not to disturb Random()
+};
+
+#endif // CACHE_H
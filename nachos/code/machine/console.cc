@@ -18,9 +18,9 @@
 #include "system.h"
 
 // Dummy functions because C++ is weird about pointers to member functions
-static void ConsoleReadPoll(int c) 
+static void ConsoleReadPoll(intptr_t c) 
 { Console *console = (Console *)c; console->CheckCharAvail(); }
-static void ConsoleWriteDone(int c)
+static void ConsoleWriteDone(intptr_t c)
 { Console *console = (Console *)c; console->WriteDone(); }
 
 //----------------------------------------------------------------------
@@ -37,7 +37,7 @@ static void ConsoleWriteDone(int c)
 //----------------------------------------------------------------------
 
 Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail, 
-		VoidFunctionPtr writeDone, int callArg)
+		VoidFunctionPtr writeDone, intptr_t callArg)
 {
     if (readFile == NULL)
 	readFileNo = 0;					// keyboard = stdin
@@ -56,7 +56,7 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     incoming = EOF;
 
     // start polling for incoming packets
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, ConsoleReadInt);
+    interrupt->Schedule(ConsoleReadPoll, (intptr_t) this, ConsoleTime, ConsoleReadInt);
 }
 
 //----------------------------------------------------------------------
@@ -81,6 +81,9 @@ Console::~Console()
 //	character has been grabbed out of the buffer by the Nachos kernel).
 //	Invoke the "read" interrupt handler, once the character has been 
 //	put into the buffer. 
+//
+//	When a run is being replayed, the characters come from the
+//	replay log instead of the keyboard.
 //----------------------------------------------------------------------
 
 void
@@ -89,15 +92,25 @@ Console::CheckCharAvail()
     char c;
 
     // schedule the next time to poll for a packet
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, 
+    interrupt->Schedule(ConsoleReadPoll, (intptr_t) this, ConsoleTime, 
 			ConsoleReadInt);
 
-    // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
-	return;	  
-
-    // otherwise, read character and tell user about it
-    Read(readFileNo, &c, sizeof(char));
+    // do nothing if character is already buffered
+    if (incoming != EOF)
+	return;
+
+    if ((replayLog != NULL) && replayLog->IsReplaying()) {
+	if (replayLog->ReplayInput(ConsoleReadInt, &c, sizeof(char)) == 0)
+	    return;
+    } else {
+	if (!PollFile(readFileNo))	// do nothing if none to be read
+	    return;
+	Read(readFileNo, &c, sizeof(char));
+	if (replayLog != NULL)
+	    replayLog->RecordInput(ConsoleReadInt, &c, sizeof(char));
+    }
+
+    // otherwise, tell user about the character
     incoming = c ;
     stats->numConsoleCharsRead++;
     (*readHandler)(handlerArg);	
@@ -118,6 +131,26 @@ Console::WriteDone()
     (*writeHandler)(handlerArg);
 }
 
+//----------------------------------------------------------------------
+// Console::ResumeInterrupt()
+// 	Re-schedule an interrupt saved in a checkpoint, to happen at time
+//	"when": either the next poll for input, or the end of a PutChar
+//	that was still in progress.
+//----------------------------------------------------------------------
+
+void
+Console::ResumeInterrupt(IntType type, int when)
+{
+    if (type == ConsoleReadInt)
+	interrupt->Schedule(ConsoleReadPoll, (intptr_t) this, 
+			when - stats->totalTicks, ConsoleReadInt);
+    else {
+	putBusy = TRUE;
+	interrupt->Schedule(ConsoleWriteDone, (intptr_t) this, 
+			when - stats->totalTicks, ConsoleWriteInt);
+    }
+}
+
 //----------------------------------------------------------------------
 // Console::GetChar()
 // 	Read a character from the input buffer, if there is any there.
@@ -145,6 +178,6 @@ Console::PutChar(char ch)
     ASSERT(putBusy == FALSE);
     WriteFile(writeFileNo, &ch, sizeof(char));
     putBusy = TRUE;
-    interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
+    interrupt->Schedule(ConsoleWriteDone, (intptr_t) this, ConsoleTime,
 					ConsoleWriteInt);
 }
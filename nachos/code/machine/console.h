@@ -25,6 +25,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "interrupt.h"
 
 // The following class defines a hardware console device.
 // Input and output to the device is simulated by reading 
@@ -38,7 +39,7 @@
 class Console {
   public:
     Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail, 
-	VoidFunctionPtr writeDone, int callArg);
+	VoidFunctionPtr writeDone, intptr_t callArg);
 				// initialize the hardware console device
     ~Console();			// clean up console emulation
 
@@ -56,6 +57,12 @@ class Console {
     void WriteDone();	 	// internal routines to signal I/O completion
     void CheckCharAvail();
 
+    void ResumeInterrupt(IntType type, int when);
+				// re-schedule an interrupt that was pending
+				// at time "when" in a checkpoint
+    char PeekChar() { return incoming; }  // save and restore the buffered
+    void UngetChar(char ch) { incoming = ch; }  // char, for checkpoints
+
   private:
     int readFileNo;			// UNIX file emulating the keyboard 
     int writeFileNo;			// UNIX file emulating the display
@@ -63,7 +70,7 @@ class Console {
 					// the PutChar I/O completes
     VoidFunctionPtr readHandler; 	// Interrupt handler to call when 
 					// a character arrives from the keyboard
-    int handlerArg;			// argument to be passed to the 
+    intptr_t handlerArg;		// argument to be passed to the 
 					// interrupt handlers
     bool putBusy;    			// Is a PutChar operation in progress?
 					// If so, you can't do another one!
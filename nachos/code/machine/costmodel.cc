@@ -0,0 +1,165 @@
+// costmodel.cc
+//	Routines to work out how long each user instruction takes.
+//	See costmodel.h.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "costmodel.h"
+#include "machine.h"
+#include "mipssim.h"
+#include "stats.h"
+#include "utility.h"
+
+// Names used in the cost file, in the order of CostClass.
+static const char *costNames[NumCostClasses] = {
+    "alu", "shift", "mult", "div", "load", "store", "branch", "jump", "other"
+};
+
+// Which opcodes fall into each class, and which registers they read.
+
+struct OpCost {
+    char opCode;
+    char costClass;
+    char readsRs, readsRt;
+};
+
+static OpCost opCosts[] = {
+    { OP_ADD, AluCost, 1, 1 },		{ OP_ADDI, AluCost, 1, 0 },
+    { OP_ADDIU, AluCost, 1, 0 },	{ OP_ADDU, AluCost, 1, 1 },
+    { OP_AND, AluCost, 1, 1 },		{ OP_ANDI, AluCost, 1, 0 },
+    { OP_LUI, AluCost, 0, 0 },		{ OP_MFHI, AluCost, 0, 0 },
+    { OP_MFLO, AluCost, 0, 0 },		{ OP_MTHI, AluCost, 1, 0 },
+    { OP_MTLO, AluCost, 1, 0 },		{ OP_NOR, AluCost, 1, 1 },
+    { OP_OR, AluCost, 1, 1 },		{ OP_ORI, AluCost, 1, 0 },
+    { OP_SLT, AluCost, 1, 1 },		{ OP_SLTI, AluCost, 1, 0 },
+    { OP_SLTIU, AluCost, 1, 0 },	{ OP_SLTU, AluCost, 1, 1 },
+    { OP_SUB, AluCost, 1, 1 },		{ OP_SUBU, AluCost, 1, 1 },
+    { OP_XOR, AluCost, 1, 1 },		{ OP_XORI, AluCost, 1, 0 },
+    { OP_SLL, ShiftCost, 0, 1 },	{ OP_SLLV, ShiftCost, 1, 1 },
+    { OP_SRA, ShiftCost, 0, 1 },	{ OP_SRAV, ShiftCost, 1, 1 },
+    { OP_SRL, ShiftCost, 0, 1 },	{ OP_SRLV, ShiftCost, 1, 1 },
+    { OP_MULT, MultCost, 1, 1 },	{ OP_MULTU, MultCost, 1, 1 },
+    { OP_DIV, DivCost, 1, 1 },		{ OP_DIVU, DivCost, 1, 1 },
+    { OP_LB, LoadCost, 1, 0 },		{ OP_LBU, LoadCost, 1, 0 },
+    { OP_LH, LoadCost, 1, 0 },		{ OP_LHU, LoadCost, 1, 0 },
+    { OP_LW, LoadCost, 1, 0 },		{ OP_LWL, LoadCost, 1, 1 },
+    { OP_LWR, LoadCost, 1, 1 },		{ OP_SB, StoreCost, 1, 1 },
+    { OP_SH, StoreCost, 1, 1 },		{ OP_SW, StoreCost, 1, 1 },
+    { OP_SWL, StoreCost, 1, 1 },	{ OP_SWR, StoreCost, 1, 1 },
+    { OP_BEQ, BranchCost, 1, 1 },	{ OP_BNE, BranchCost, 1, 1 },
+    { OP_BGEZ, BranchCost, 1, 0 },	{ OP_BGEZAL, BranchCost, 1, 0 },
+    { OP_BGTZ, BranchCost, 1, 0 },	{ OP_BLEZ, BranchCost, 1, 0 },
+    { OP_BLTZ, BranchCost, 1, 0 },	{ OP_BLTZAL, BranchCost, 1, 0 },
+    { OP_J, JumpCost, 0, 0 },		{ OP_JAL, JumpCost, 0, 0 },
+    { OP_JR, JumpCost, 1, 0 },		{ OP_JALR, JumpCost, 1, 0 },
+};
+
+//----------------------------------------------------------------------
+// CostModel::CostModel
+// 	Read a cost model from a file.  See costmodel.h for the format.
+//
+//	"fileName" -- the UNIX file holding the costs
+//----------------------------------------------------------------------
+
+CostModel::CostModel(char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    char line[200], name[100];
+    int i, value;
+
+    if (file == NULL) {
+	fprintf(stderr, "Can't open cost model \"%s\"\n", fileName);
+	Abort();
+    }
+
+    for (i = 0; i < NumCostClasses; i++)
+	cycles[i] = UserTick;
+    loadUseStall = takenPenalty = 0;
+    costClass = new char[MaxOpcode + 1];
+    readsRs = new char[MaxOpcode + 1];
+    readsRt = new char[MaxOpcode + 1];
+    for (i = 0; i <= MaxOpcode; i++) {
+	costClass[i] = OtherCost;
+	readsRs[i] = readsRt[i] = FALSE;
+    }
+    for (i = 0; i < (int) (sizeof(opCosts) / sizeof(OpCost)); i++) {
+	costClass[(int) opCosts[i].opCode] = opCosts[i].costClass;
+	readsRs[(int) opCosts[i].opCode] = opCosts[i].readsRs;
+	readsRt[(int) opCosts[i].opCode] = opCosts[i].readsRt;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+	char *comment = strchr(line, '#');
+	if (comment != NULL)
+	    *comment = '\0';
+	if (sscanf(line, "%99s", name) != 1)
+	    continue;			// blank line
+	if ((sscanf(line, "%*s %d", &value) != 1) || (value < 0)) {
+	    fprintf(stderr, "Bad cost for \"%s\" in %s\n", name, fileName);
+	    Abort();
+	}
+	if (!strcmp(name, "loaduse"))
+	    loadUseStall = value;
+	else if (!strcmp(name, "taken"))
+	    takenPenalty = value;
+	else {
+	    for (i = 0; i < NumCostClasses; i++)
+		if (!strcmp(name, costNames[i]))
+		    break;
+	    if ((i == NumCostClasses) || (value < UserTick)) {
+		fprintf(stderr, "Bad cost \"%s %d\" in %s\n", name, value,
+			fileName);
+		Abort();
+	    }
+	    cycles[i] = value;
+	}
+    }
+    fclose(file);
+}
+
+CostModel::~CostModel()
+{
+    delete [] costClass;
+    delete [] readsRs;
+    delete [] readsRt;
+}
+
+//----------------------------------------------------------------------
+// CostModel::LoadedRegister
+// 	Return the register a load instruction writes, or 0 if "instr"
+//	isn't a load.
+//----------------------------------------------------------------------
+
+int
+CostModel::LoadedRegister(Instruction *instr)
+{
+    return (costClass[(int) instr->opCode] == LoadCost) ? instr->rt : 0;
+}
+
+//----------------------------------------------------------------------
+// CostModel::Cycles
+// 	Return the number of ticks "instr" took to run.
+//
+//	"lastLoad" -- the register loaded by the previous instruction,
+//		or 0
+//	"taken" -- TRUE if "instr" is a branch or jump that was taken
+//----------------------------------------------------------------------
+
+int
+CostModel::Cycles(Instruction *instr, int lastLoad, bool taken)
+{
+    int op = instr->opCode;
+    int result = cycles[(int) costClass[op]];
+
+    if ((lastLoad != 0) && ((readsRs[op] && (instr->rs == lastLoad))
+			    || (readsRt[op] && (instr->rt == lastLoad))))
+	result += loadUseStall;
+    if (taken)
+	result += takenPenalty;
+    return result;
+}
@@ -0,0 +1,70 @@
+// costmodel.h
+//	Data structures for charging user instructions by what they do.
+//
+//	Normally every user instruction takes UserTick to run.  With a
+//	cost model (-cost <file>), each instruction instead takes the
+//	number of cycles given for its class -- a divide can cost far
+//	more than an add -- plus a stall if it uses the result of the
+//	load just before it, plus a penalty if it is a branch or jump
+//	that was taken.
+//
+//	The cost file has one "<name> <cycles>" pair per line, with '#'
+//	starting a comment.  The names are those in costNames (costmodel.cc):
+//	one per class of instruction, then "loaduse" and "taken" for the
+//	two penalties.  Anything not mentioned costs UserTick, with no
+//	penalties, so an empty file charges the same as no cost model.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include "copyright.h"
+
+class Instruction;
+
+// The classes of instruction that can be given different costs.
+
+enum CostClass { AluCost,		// add, and, slt, lui, mfhi, ...
+		 ShiftCost,		// sll, srav, ...
+		 MultCost,		// mult, multu
+		 DivCost,		// div, divu
+		 LoadCost,		// lb, lw, lwl, ...
+		 StoreCost,		// sb, sw, swl, ...
+		 BranchCost,		// beq, bgez, bltzal, ...
+		 JumpCost,		// j, jal, jr, jalr
+		 OtherCost,		// syscall, and the rest
+		 NumCostClasses };
+
+// The following class defines the cost of each kind of instruction.
+
+class CostModel {
+  public:
+    CostModel(char *fileName);		// read the costs from "fileName"
+    ~CostModel();
+
+    int Cycles(Instruction *instr, int lastLoad, bool taken);
+					// the time to run "instr", which
+					// has just run; "lastLoad" is the
+					// register loaded by the instruction
+					// before it (0 if none), and "taken"
+					// is TRUE if it jumped
+
+    int LoadedRegister(Instruction *instr);  // the register "instr"
+					// loads from memory, or 0
+
+  private:
+    int cycles[NumCostClasses];		// cost of each class
+    int loadUseStall;			// extra cycles for using a register
+					// right after loading it
+    int takenPenalty;			// extra cycles for a taken branch
+    char *costClass;			// the class of each opcode
+    char *readsRs;			// TRUE if the opcode reads rs,
+    char *readsRt;			// and rt
+};
+
+#endif // COSTMODEL_H
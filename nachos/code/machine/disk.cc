@@ -26,7 +26,7 @@
 #define DiskSize 	(MagicSize + (NumSectors * SectorSize))
 
 // dummy procedure because we can't take a pointer of a member function
-static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
+static void DiskDone(intptr_t arg) { ((Disk *)arg)->HandleInterrupt(); }
 
 //----------------------------------------------------------------------
 // Disk::Disk()
@@ -40,7 +40,7 @@ static void DiskDone(int arg) { ((Disk *)arg)->HandleInterrupt(); }
 //	"callArg" -- argument to pass the interrupt handler
 //----------------------------------------------------------------------
 
-Disk::Disk(char* name, VoidFunctionPtr callWhenDone, int callArg)
+Disk::Disk(char* name, VoidFunctionPtr callWhenDone, intptr_t callArg)
 {
     int magicNum;
     int tmp = 0;
@@ -121,6 +121,8 @@ Disk::ReadRequest(int sectorNumber, char* data)
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
     DEBUG('d', "Reading from sector %d\n", sectorNumber);
+    if (eventTrace != NULL)
+	eventTrace->Record(TraceDiskRead, 0, sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
     Read(fileno, data, SectorSize);
     if (DebugIsEnabled('d'))
@@ -129,7 +131,7 @@ Disk::ReadRequest(int sectorNumber, char* data)
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskReads++;
-    interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
+    interrupt->Schedule(DiskDone, (intptr_t) this, ticks, DiskInt);
 }
 
 void
@@ -141,6 +143,8 @@ Disk::WriteRequest(int sectorNumber, char* data)
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
     DEBUG('d', "Writing to sector %d\n", sectorNumber);
+    if (eventTrace != NULL)
+	eventTrace->Record(TraceDiskWrite, 0, sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
     WriteFile(fileno, data, SectorSize);
     if (DebugIsEnabled('d'))
@@ -149,7 +153,7 @@ Disk::WriteRequest(int sectorNumber, char* data)
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskWrites++;
-    interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
+    interrupt->Schedule(DiskDone, (intptr_t) this, ticks, DiskInt);
 }
 
 //----------------------------------------------------------------------
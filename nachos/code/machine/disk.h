@@ -54,7 +54,7 @@
 
 class Disk {
   public:
-    Disk(char* name, VoidFunctionPtr callWhenDone, int callArg);
+    Disk(char* name, VoidFunctionPtr callWhenDone, intptr_t callArg);
     					// Create a simulated disk.  
 					// Invoke (*callWhenDone)(callArg) 
 					// every time a request completes.
@@ -79,7 +79,7 @@ class Disk {
     int fileno;				// UNIX file number for simulated disk 
     VoidFunctionPtr handler;		// Interrupt handler, to be invoked 
 					// when any disk request finishes
-    int handlerArg;			// Argument to interrupt handler 
+    intptr_t handlerArg;		// Argument to interrupt handler 
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
     int bufferInit;			// When the track buffer started 
@@ -21,13 +21,14 @@
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include <limits.h>
 #include "interrupt.h"
 #include "system.h"
 
 // String definitions for debugging messages
 
 static char *intLevelNames[] = { "off", "on"};
-static char *intTypeNames[] = { "timer", "disk", "console write", 
+char *intTypeNames[] = { "timer", "disk", "console write", 
 			"console read", "network send", "network recv"};
 
 //----------------------------------------------------------------------
@@ -41,7 +42,7 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 //	"kind" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
 
-PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time, 
+PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, intptr_t param, int time, 
 				IntType kind)
 {
     handler = func;
@@ -178,6 +179,32 @@ Interrupt::OneTick()
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::NextDueTime
+// 	Return the simulated time of the next pending interrupt.  Until
+//	then, OneTick does nothing but advance the clock, so a caller
+//	can safely account for several ticks at once (the block
+//	cache uses this to run a whole block between checks).
+//
+//	If two interrupts are due at the same time, CheckIfDue rotates
+//	them on every tick, so the exact number of calls matters; we
+//	return the current time in that case to force tick-by-tick
+//	simulation.
+//----------------------------------------------------------------------
+
+int
+Interrupt::NextDueTime()
+{
+    int when;
+    bool tied;
+
+    if (pending->SortedPeek(&when, &tied) == NULL)
+	return INT_MAX;			// nothing pending at all
+    if (tied)
+	return stats->totalTicks;
+    return when;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -262,7 +289,7 @@ Interrupt::Halt()
 //	"type" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
 void
-Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
+Interrupt::Schedule(VoidFunctionPtr handler, intptr_t arg, int fromNow, IntType type)
 {
     int when = stats->totalTicks + fromNow;
     PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
@@ -324,6 +351,13 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (machine != NULL)
     	machine->DelayedLoad(0, 0);
 #endif
+    if (replayLog != NULL)
+	replayLog->Delivered(toOccur->type);
+    if ((eventTrace != NULL) && (toOccur->type != ConsoleReadInt)
+			&& (toOccur->type != NetworkRecvInt))
+	eventTrace->Record(TraceInterrupt, 0, toOccur->type);
+						// (but not the device polls,
+						// which would swamp the rest)
     inHandler = TRUE;
     status = SystemMode;			// whatever we were doing,
 						// we are now going to be
@@ -342,7 +376,7 @@ Interrupt::CheckIfDue(bool advanceClock)
 //----------------------------------------------------------------------
 
 static void
-PrintPending(int arg)
+PrintPending(intptr_t arg)
 {
     PendingInterrupt *pend = (PendingInterrupt *)arg;
 
@@ -350,6 +384,32 @@ PrintPending(int arg)
 	intTypeNames[pend->type], pend->when);
 }
 
+//----------------------------------------------------------------------
+// Interrupt::ForEachPending
+// 	Apply "func" to each pending interrupt, passing it a pointer to
+//	the PendingInterrupt, in the order the interrupts will happen.
+//----------------------------------------------------------------------
+
+void
+Interrupt::ForEachPending(VoidFunctionPtr func)
+{
+    pending->Mapcar(func);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::CancelPending
+// 	Throw away every pending interrupt.  Only used when restoring a
+//	checkpoint; the devices then re-schedule the interrupts that were
+//	pending when it was taken.
+//----------------------------------------------------------------------
+
+void
+Interrupt::CancelPending()
+{
+    while (!pending->IsEmpty())
+	delete (PendingInterrupt *)pending->Remove();
+}
+
 //----------------------------------------------------------------------
 // DumpState
 // 	Print the complete interrupt state - the status, and all interrupts
@@ -51,6 +51,7 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 // display and keyboard, and a network.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
 				NetworkSendInt, NetworkRecvInt};
+extern char *intTypeNames[];	// their names, for messages
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -58,13 +59,13 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
-    PendingInterrupt(VoidFunctionPtr func, int param, int time, IntType kind);
+    PendingInterrupt(VoidFunctionPtr func, intptr_t param, int time, IntType kind);
 				// initialize an interrupt that will
 				// occur in the future
 
     VoidFunctionPtr handler;    // The function (in the hardware device
 				// emulator) to call when the interrupt occurs
-    int arg;                    // The argument to the function.
+    intptr_t arg;               // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
 };
@@ -99,6 +100,14 @@ class Interrupt {
     void setStatus(MachineStatus st) { status = st; }
 
     void DumpState();			// Print interrupt state
+
+    void ForEachPending(VoidFunctionPtr func);
+					// Apply "func" to every pending
+					// interrupt, in the order they will
+					// happen; for checkpoints
+    void CancelPending();		// Forget every pending interrupt, so
+					// that the ones saved in a checkpoint
+					// can be re-scheduled in their place
     
 
     // NOTE: the following are internal to the hardware simulation code.
@@ -107,11 +116,14 @@ class Interrupt {
     // hardware device simulators.
 
     void Schedule(VoidFunctionPtr handler,// Schedule an interrupt to occur
-	int arg, int when, IntType type);// at time ``when''.  This is called
+	intptr_t arg, int when, IntType type);// at time ``when''.  This is called
     					// by the hardware device simulators.
     
     void OneTick();       		// Advance simulated time
 
+    int NextDueTime();			// Earliest time at which OneTick
+					// might have anything to do
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
     List *pending;		// the list of interrupts scheduled
@@ -9,6 +9,9 @@
 
 #include "copyright.h"
 #include "machine.h"
+#include "blockcache.h"
+#include "cache.h"
+#include "costmodel.h"
 #include "system.h"
 
 // Textual names of the exceptions that can be generated by user program
@@ -50,9 +53,17 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"cacheThreshold" -- number of times a basic block must be
+//		entered before it is pre-decoded; 0 means never.
+//	"tlbEntries", "tlbAssociativity" -- the size of the TLB, and of
+//		each of its sets, if it has one (with USE_TLB)
+//	"instrCache", "dataCache" -- the caches to model, or NULL
+//	"costModel" -- the time each kind of instruction takes, or NULL
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, int cacheThreshold, int tlbEntries,
+		 int tlbAssociativity, Cache *instrCache, Cache *dataCache,
+		 CostModel *costModel)
 {
     int i;
 
@@ -62,17 +73,55 @@ Machine::Machine(bool debug)
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
 #ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
+    // An instruction may need two translations at once, for its own
+    // page and the page it loads from or stores to; if they could
+    // only go in the same entry, it would miss for ever.  (0 entries
+    // would divide by zero in TLBSet.)
+    ASSERT((tlbAssociativity >= 2) && (tlbEntries >= tlbAssociativity)
+	   && (tlbEntries % tlbAssociativity == 0));
+    tlbSize = tlbEntries;
+    tlbWays = tlbAssociativity;
+    tlb = new TranslationEntry[tlbSize];
+    tlbASID = new int[tlbSize];
+    for (i = 0; i < tlbSize; i++)
 	tlb[i].valid = FALSE;
+    tlbNext = new int[tlbSize / tlbWays];
+    for (i = 0; i < tlbSize / tlbWays; i++)
+	tlbNext[i] = 0;
     NachOSpageTable = NULL;
 #else	// use linear page table
+    tlbSize = tlbWays = 0;
     tlb = NULL;
+    tlbASID = tlbNext = NULL;
     NachOSpageTable = NULL;
 #endif
+    currentASID = 0;
 
     singleStep = debug;
+    icache = instrCache;
+    dcache = dataCache;
+    costs = costModel;
+    lastLoad = 0;
     CheckEndian();
+
+    // The block cache skips the per-instruction fetch and trace, so keep
+    // it out of the way when single stepping, tracing instructions, or
+    // modelling the instruction cache.  It also charges whole blocks up
+    // front, at UserTick per instruction, which a cache miss in the
+    // middle or a cost model would upset.
+    blockCache = NULL;
+    if ((cacheThreshold > 0) && !singleStep && !DebugIsEnabled('m')
+		&& !DebugIsEnabled('a') && !DebugIsEnabled('i')
+		&& (icache == NULL) && (dcache == NULL) && (costs == NULL))
+	blockCache = new BlockCache(cacheThreshold);
+
+    // Similarly, address translation messages are only printed on
+    // the slow path.
+    hostTLB = NULL;
+    if (!DebugIsEnabled('a')) {
+	hostTLB = new HostTLBEntry[HostTLBSize];
+	FlushHostTLB();
+    }
 }
 
 //----------------------------------------------------------------------
@@ -83,8 +132,72 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
+    if (tlb != NULL) {
         delete [] tlb;
+	delete [] tlbASID;
+	delete [] tlbNext;
+    }
+    if (blockCache != NULL)
+	delete blockCache;
+    if (hostTLB != NULL)
+	delete [] hostTLB;
+    if (icache != NULL)
+	delete icache;
+    if (dcache != NULL)
+	delete dcache;
+    if (costs != NULL)
+	delete costs;
+}
+
+//----------------------------------------------------------------------
+// Machine::Checkpoint
+// 	Save the state of the simulated hardware -- the registers, main
+//	memory, and the contents of the caches, if any -- in the
+//	checkpoint file "fd".
+//----------------------------------------------------------------------
+
+void
+Machine::Checkpoint(int fd)
+{
+    int caches[2] = { icache != NULL, dcache != NULL };
+
+    WriteFile(fd, (char *)registers, sizeof(registers));
+    WriteFile(fd, mainMemory, MemorySize);
+    WriteFile(fd, (char *)&lastLoad, sizeof(lastLoad));
+    WriteFile(fd, (char *)caches, sizeof(caches));
+    if (icache != NULL)
+	icache->Checkpoint(fd);
+    if (dcache != NULL)
+	dcache->Checkpoint(fd);
+}
+
+//----------------------------------------------------------------------
+// Machine::Restore
+// 	Read back the hardware state saved by Checkpoint.  The machine
+//	must be modelling the same caches as the one that was saved.
+//	Anything cached about the old contents of memory is dropped.
+//----------------------------------------------------------------------
+
+void
+Machine::Restore(int fd)
+{
+    int caches[2];
+
+    Read(fd, (char *)registers, sizeof(registers));
+    Read(fd, mainMemory, MemorySize);
+    Read(fd, (char *)&lastLoad, sizeof(lastLoad));
+    Read(fd, (char *)caches, sizeof(caches));
+    if ((caches[0] != (icache != NULL)) || (caches[1] != (dcache != NULL))) {
+	fprintf(stderr, "Checkpoint was taken with different caches\n");
+	Abort();
+    }
+    if (icache != NULL)
+	icache->Restore(fd);
+    if (dcache != NULL)
+	dcache->Restore(fd);
+    for (int i = 0; i < NumPhysPages; i++)
+	InvalidateCachedCode(i);
+    FlushHostTLB();
 }
 
 //----------------------------------------------------------------------
@@ -104,6 +217,8 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     
 //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
+    if (blockCache != NULL)
+	blockCache->Settle();		// fix up counts charged in advance
     DelayedLoad(0, 0);			// finish anything in progress
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
@@ -212,3 +327,20 @@ void Machine::WriteRegister(int num, int value)
 	registers[num] = value;
     }
 
+//----------------------------------------------------------------------
+// Machine::InvalidateCachedCode
+//	Called by the kernel whenever it writes to physical memory
+//	directly (for instance, when loading a program), so that stale
+//	cached code for that page is never run.  Stores made by the
+//	user program itself are caught in WriteMem.
+//
+//	"physPage" -- the physical page that was modified
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateCachedCode(int physPage)
+{
+    if (blockCache != NULL)
+	blockCache->InvalidatePage(physPage);
+}
+
@@ -26,15 +26,25 @@
 #include "translate.h"
 #include "disk.h"
 
-// Definitions related to the size, and format of user memory
+// Definitions related to the size, and format of user memory.
+// The page size and the number of physical pages are chosen when
+// Nachos starts (see -ps and -mem), and main memory is made to fit.
 
-#define PageSize 	SectorSize 	// set the page size equal to
-					// the disk sector size, for
-					// simplicity
+#define DefaultPageSize	SectorSize 	// by default, set the page size
+					// equal to the disk sector size,
+					// for simplicity
+#define DefaultNumPhysPages 512
 
-#define NumPhysPages    512
+#define PageSize 	pageSize
+#define NumPhysPages    numPhysPages
 #define MemorySize 	(NumPhysPages * PageSize)
+
+extern thread_local int pageSize;	// bytes in a page: a power of 2
+extern thread_local int numPhysPages;	// frames of main memory
 #define TLBSize		4		// if there is a TLB, make it small
+					// (by default; see -tlb)
+#define HostTLBSize	64		// entries in the simulator's private
+					// cache of translations (power of 2)
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -104,34 +114,98 @@ class Instruction {
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
+class BlockCache;
+class Cache;
+class CostModel;
+
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
-				// for running user programs
+    Machine(bool debug, int cacheThreshold, int tlbEntries,
+	    int tlbAssociativity, Cache *instrCache, Cache *dataCache,
+	    CostModel *costModel);
+				// Initialize the simulation of the hardware
+				// for running user programs; hot blocks are
+				// pre-decoded once entered "cacheThreshold"
+				// times (0 disables the block cache).
+				// With USE_TLB, the TLB has "tlbEntries"
+				// entries, in sets of "tlbAssociativity".
+				// The caches may be NULL, for memory that
+				// always takes the same time, and the cost
+				// model NULL, for instructions that all
+				// take UserTick.
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
     void Run();	 		// Run a user program
 
+    void ResumeAfterTrap();	// Finish a trap into the kernel, and
+				// carry on running the user program
+
+    void Checkpoint(int fd);	// Save the hardware state in a checkpoint
+    void Restore(int fd);	// and read it back
+
+    void ForgetLastLoad();	// another thread's user state is being
+				// restored; it can't stall on the last
+				// user instruction's load
+
     int ReadRegister(int num);	// read the contents of a CPU register
 
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    void InvalidateCachedCode(int physPage);
+				// the kernel has changed the contents of
+				// physical page "physPage" behind the
+				// simulator's back; drop any cached
+				// code that came from it
+
+    void FlushHostTLB();	// the kernel has switched page tables, or
+				// changed an entry in the page table or TLB;
+				// forget any cached translations
+
+    void LoadTLB(TranslationEntry *entry);
+				// put "entry" in the TLB, for the address
+				// space currentASID (on a TLB miss)
+    void InvalidateTLBEntry(int asid, int vpn);
+				// drop the TLB entry for page "vpn" of
+				// address space "asid", if there is one
+    void FlushTLB(int asid);	// drop all of address space "asid"'s
+				// TLB entries
+
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
     void OneInstruction(Instruction *instr); 	
     				// Run one instruction of a user program.
+    bool ExecuteInstruction(Instruction *instr);
+				// Run an already decoded instruction;
+				// return FALSE if it raised an exception
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
+    void ChargeCycles(Instruction *instr);
+				// Charge for the time an instruction took,
+				// beyond UserTick, under the cost model
     
-    bool ReadMem(int addr, int size, int* value);
+    bool ReadMem(int addr, int size, int* value)
+	{ return ReadMem(addr, size, value, dcache); }
+    bool ReadMem(int addr, int size, int* value, Cache *cache);
     bool WriteMem(int addr, int size, int value);
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+				// Reads go through "cache" if given (the
+				// instruction cache, for fetches), or else
+				// the data cache.
+    void CacheAccess(Cache *cache, char *location);
+				// Look up "location" in "cache", and charge
+				// for a miss
     
+    char *HostAddress(int virtAddr, int size, bool writing);
+				// Look up "virtAddr" in the host TLB; return
+				// where it is in mainMemory, or NULL on a miss
+    void CacheHostAddress(int virtAddr, char *location, bool writing);
+				// Add a translation to the host TLB
+
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
 				// alignment.  Set the use and dirty bits in 
@@ -178,9 +252,18 @@ class Machine {
 // space, stored in memory), there is only one TLB (implemented in hardware).
 // Thus the TLB pointer should be considered as *read-only*, although 
 // the contents of the TLB are free to be modified by the kernel software.
+//
+// The TLB is set associative: a page's translation can only be in the
+// "tlbWays" entries of the set its page number and address space ID
+// hash to, so a lookup doesn't search the whole TLB.  Each entry is
+// tagged with the ID of the address space it belongs to, and only
+// matches while that address space is running (currentASID), so a
+// context switch doesn't have to flush the TLB.
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int currentASID;			// the address space running, as far
+					// as the TLB is concerned
 
     TranslationEntry *NachOSpageTable;
     unsigned int NachOSpageTableSize;
@@ -190,6 +273,27 @@ class Machine {
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+    BlockCache *blockCache;	// cache of pre-decoded hot blocks, or
+				// NULL if it is disabled
+    HostTLBEntry *hostTLB;	// recent translations, for ReadMem and
+				// WriteMem; NULL if disabled
+    int tlbSize;		// number of TLB entries, if there is a TLB
+    int tlbWays;		// ... and the number in each set
+    int *tlbASID;		// the address space each TLB entry is for
+    int *tlbNext;		// for each set, the entry to replace next
+				// if none is free
+
+    int TLBSet(unsigned int vpn, int asid);
+				// the first entry of the set that may
+				// hold the translation of "vpn" for "asid"
+    void ForgetHostTranslation(unsigned int vpn);
+				// drop "vpn" from the host TLB
+    Cache *icache;		// the instruction and data caches, or NULL
+    Cache *dcache;		// if we're not modelling them
+    CostModel *costs;		// time taken by each kind of instruction,
+				// or NULL if they all take UserTick
+    int lastLoad;		// register loaded by the last instruction,
+				// for the cost model's load-use stall
 };
 
 extern void ExceptionHandler(ExceptionType which);
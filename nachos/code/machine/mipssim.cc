@@ -14,9 +14,119 @@
 
 #include "machine.h"
 #include "mipssim.h"
+#include "blockcache.h"
+#include "costmodel.h"
 #include "system.h"
 
-static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
+/*
+ * The table below is used to translate bits 31:26 of the instruction
+ * into a value suitable for the "opCode" field of a MemWord structure,
+ * or into a special value for further decoding.
+ */
+
+static OpInfo opTable[] = {
+    {SPECIAL, RFMT}, {BCOND, IFMT}, {OP_J, JFMT}, {OP_JAL, JFMT},
+    {OP_BEQ, IFMT}, {OP_BNE, IFMT}, {OP_BLEZ, IFMT}, {OP_BGTZ, IFMT},
+    {OP_ADDI, IFMT}, {OP_ADDIU, IFMT}, {OP_SLTI, IFMT}, {OP_SLTIU, IFMT},
+    {OP_ANDI, IFMT}, {OP_ORI, IFMT}, {OP_XORI, IFMT}, {OP_LUI, IFMT},
+    {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
+    {OP_LB, IFMT}, {OP_LH, IFMT}, {OP_LWL, IFMT}, {OP_LW, IFMT},
+    {OP_LBU, IFMT}, {OP_LHU, IFMT}, {OP_LWR, IFMT}, {OP_RES, IFMT},
+    {OP_SB, IFMT}, {OP_SH, IFMT}, {OP_SWL, IFMT}, {OP_SW, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_SWR, IFMT}, {OP_RES, IFMT},
+    {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT},
+    {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT},
+    {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}
+};
+
+/*
+ * The table below is used to convert the "funct" field of SPECIAL
+ * instructions into the "opCode" field of a MemWord.
+ */
+
+static int specialTable[] = {
+    OP_SLL, OP_RES, OP_SRL, OP_SRA, OP_SLLV, OP_RES, OP_SRLV, OP_SRAV,
+    OP_JR, OP_JALR, OP_RES, OP_RES, OP_SYSCALL, OP_UNIMP, OP_RES, OP_RES,
+    OP_MFHI, OP_MTHI, OP_MFLO, OP_MTLO, OP_RES, OP_RES, OP_RES, OP_RES,
+    OP_MULT, OP_MULTU, OP_DIV, OP_DIVU, OP_RES, OP_RES, OP_RES, OP_RES,
+    OP_ADD, OP_ADDU, OP_SUB, OP_SUBU, OP_AND, OP_OR, OP_XOR, OP_NOR,
+    OP_RES, OP_RES, OP_SLT, OP_SLTU, OP_RES, OP_RES, OP_RES, OP_RES,
+    OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES,
+    OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES
+};
+
+// How to print out each instruction, for debugging
+
+static struct OpString opStrings[] = {
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"ADD r%d,r%d,r%d", {RD, RS, RT}},
+	{"ADDI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"ADDIU r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"ADDU r%d,r%d,r%d", {RD, RS, RT}},
+	{"AND r%d,r%d,r%d", {RD, RS, RT}},
+	{"ANDI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"BEQ r%d,r%d,%d", {RS, RT, EXTRA}},
+	{"BGEZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BGEZAL r%d,%d", {RS, EXTRA, NONE}},
+	{"BGTZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLEZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLTZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLTZAL r%d,%d", {RS, EXTRA, NONE}},
+	{"BNE r%d,r%d,%d", {RS, RT, EXTRA}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"DIV r%d,r%d", {RS, RT, NONE}},
+	{"DIVU r%d,r%d", {RS, RT, NONE}},
+	{"J %d", {EXTRA, NONE, NONE}},
+	{"JAL %d", {EXTRA, NONE, NONE}},
+	{"JALR r%d,r%d", {RD, RS, NONE}},
+	{"JR r%d,r%d", {RD, RS, NONE}},
+	{"LB r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LBU r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LH r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LHU r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LUI r%d,%d", {RT, EXTRA, NONE}},
+	{"LW r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LWL r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LWR r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"MFHI r%d", {RD, NONE, NONE}},
+	{"MFLO r%d", {RD, NONE, NONE}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"MTHI r%d", {RS, NONE, NONE}},
+	{"MTLO r%d", {RS, NONE, NONE}},
+	{"MULT r%d,r%d", {RS, RT, NONE}},
+	{"MULTU r%d,r%d", {RS, RT, NONE}},
+	{"NOR r%d,r%d,r%d", {RD, RS, RT}},
+	{"OR r%d,r%d,r%d", {RD, RS, RT}},
+	{"ORI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"RFE", {NONE, NONE, NONE}},
+	{"SB r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SH r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SLL r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SLLV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SLT r%d,r%d,r%d", {RD, RS, RT}},
+	{"SLTI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SLTIU r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SLTU r%d,r%d,r%d", {RD, RS, RT}},
+	{"SRA r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SRAV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SRL r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SRLV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SUB r%d,r%d,r%d", {RD, RS, RT}},
+	{"SUBU r%d,r%d,r%d", {RD, RS, RT}},
+	{"SW r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SWL r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SWR r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"XOR r%d,r%d,r%d", {RD, RS, RT}},
+	{"XORI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SYSCALL", {NONE, NONE, NONE}},
+	{"Unimplemented", {NONE, NONE, NONE}},
+	{"Reserved", {NONE, NONE, NONE}}
+      };
 
 //----------------------------------------------------------------------
 // Machine::Run
@@ -25,6 +135,16 @@ static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	Whenever the program counter lands at the start of a new basic
+//	block (that is, anywhere but just past the previous instruction),
+//	the block cache gets a chance to run pre-decoded code from there.
+//	Only the block cache charges instructions and ticks once per
+//	block; here they are still charged one instruction at a time.
+//
+//	Without a block cache, profiler or pending checkpoint, none of that
+//	applies, so we use a loop that does no more per instruction than
+//	it did before any of them existed.
 //----------------------------------------------------------------------
 
 void
@@ -36,7 +156,24 @@ Machine::Run()
         printf("Starting thread \"%s\" at time %d\n",
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
+    if ((blockCache == NULL) && (profiler == NULL) && (checkpointFile == NULL)) {
+	for (;;) {
+	    currentThread->IncInstructionCount();
+	    OneInstruction(instr);
+	    interrupt->OneTick();
+	    if (singleStep && (runUntilTime <= stats->totalTicks))
+	      Debugger();
+	}
+    }
     for (;;) {
+	if ((checkpointFile != NULL) && (stats->totalTicks >= checkpointTime)
+		&& TakeCheckpoint(checkpointFile))
+	    checkpointFile = NULL;
+	if ((blockCache != NULL) && 
+		(registers[PCReg] != registers[PrevPCReg] + 4))
+	    blockCache->Run();
+	if (profiler != NULL)
+	    profiler->Tick(registers[PCReg], stats->totalTicks);
         currentThread->IncInstructionCount();
         OneInstruction(instr);
 	interrupt->OneTick();
@@ -46,6 +183,24 @@ Machine::Run()
 }
 
 
+//----------------------------------------------------------------------
+// Machine::ResumeAfterTrap
+// 	Pick up where RaiseException left off, once the kernel has
+//	finished with a trap: go back to user mode, and on to the end of
+//	the trapping instruction, as OneInstruction and Run would.  Used
+//	to resume a thread restored from a checkpoint taken while it was
+//	in a system call.
+//----------------------------------------------------------------------
+
+void
+Machine::ResumeAfterTrap()
+{
+    interrupt->setStatus(UserMode);
+    lastLoad = 0;
+    interrupt->OneTick();
+    Run();
+}
+
 //----------------------------------------------------------------------
 // TypeToReg
 // 	Retrieve the register # referred to in an instruction. 
@@ -95,12 +250,9 @@ void
 Machine::OneInstruction(Instruction *instr)
 {
     int raw;
-    int nextLoadReg = 0; 	
-    int nextLoadValue = 0; 	// record delayed load operation, to apply
-				// in the future
 
     // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
+    if (!machine->ReadMem(registers[PCReg], 4, &raw, icache))
 	return;			// exception occurred
     instr->value = raw;
     instr->Decode();
@@ -115,30 +267,93 @@ Machine::OneInstruction(Instruction *instr)
        printf("\n");
        }
     
+    if (ExecuteInstruction(instr)) {
+	if (costs != NULL)
+	    ChargeCycles(instr);
+    } else
+	lastLoad = 0;
+}
+
+//----------------------------------------------------------------------
+// Machine::ChargeCycles
+// 	Under a cost model, charge for the time "instr" took beyond the
+//	UserTick that Interrupt::OneTick will charge for it.
+//
+//	By now the PC registers have moved on: if the next PC isn't just
+//	after the current one, "instr" was a branch or jump that was taken.
+//----------------------------------------------------------------------
+
+void
+Machine::ChargeCycles(Instruction *instr)
+{
+    bool taken = (registers[NextPCReg] != registers[PCReg] + 4);
+    int extra = costs->Cycles(instr, lastLoad, taken) - UserTick;
+
+    lastLoad = costs->LoadedRegister(instr);
+    stats->totalTicks += extra;
+    stats->userTicks += extra;
+}
+
+//----------------------------------------------------------------------
+// Machine::ForgetLastLoad
+// 	The kernel is switching to another thread's user state.  Its next
+//	instruction follows the kernel's, not the last user instruction
+//	run, so it can't stall on that instruction's load.
+//----------------------------------------------------------------------
+
+void
+Machine::ForgetLastLoad()
+{
+    lastLoad = 0;
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute an instruction that has already been fetched and decoded,
+//	then apply any pending delayed load and advance the program
+//	counters.  Shared by OneInstruction and by the block cache,
+//	which runs pre-decoded instructions out of it.
+//
+//	Returns FALSE if the instruction raised an exception (the exception
+//	handler has already been run in that case), TRUE otherwise.
+//----------------------------------------------------------------------
+
+bool
+Machine::ExecuteInstruction(Instruction *instr)
+{
+    int nextLoadReg = 0; 	
+    int nextLoadValue = 0; 	// record delayed load operation, to apply
+				// in the future
+
     // Compute next pc, but don't install in case there's an error or branch.
     int pcAfter = registers[NextPCReg] + 4;
     int sum, diff, tmp, value;
+    long long product;		// the 64-bit result of a multiply
     unsigned int rs, rt, imm;
 
     // Execute the instruction (cf. Kane's book)
     switch (instr->opCode) {
 	
       case OP_ADD:
-	sum = registers[instr->rs] + registers[instr->rt];
+	// Add as unsigned: signed overflow is undefined in C++, and the
+	// optimizer is entitled to remove the overflow test below.
+	sum = (int) ((unsigned int) registers[instr->rs]
+		     + (unsigned int) registers[instr->rt]);
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
 	
       case OP_ADDI:
-	sum = registers[instr->rs] + instr->extra;
+	sum = (int) ((unsigned int) registers[instr->rs]
+		     + (unsigned int) instr->extra);
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -194,12 +409,16 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_DIV:
+	// Divide in 64 bits, so that 0x80000000 / -1 wraps around as it
+	// does on the MIPS, instead of trapping on the host.
 	if (registers[instr->rt] == 0) {
 	    registers[LoReg] = 0;
 	    registers[HiReg] = 0;
 	} else {
-	    registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
-	    registers[HiReg] = registers[instr->rs] % registers[instr->rt];
+	    registers[LoReg] = (int) ((long long) registers[instr->rs]
+				      / registers[instr->rt]);
+	    registers[HiReg] = (int) ((long long) registers[instr->rs]
+				      % registers[instr->rt]);
 	}
 	break;
 	
@@ -233,7 +452,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
 	if (!machine->ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -248,10 +467,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -270,10 +489,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -287,7 +506,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -318,7 +537,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -360,13 +579,17 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_MULT:
-	Mult(registers[instr->rs], registers[instr->rt], TRUE,
-	     &registers[HiReg], &registers[LoReg]);
+	product = (long long) registers[instr->rs] * registers[instr->rt];
+	registers[HiReg] = (int) (product >> 32);
+	registers[LoReg] = (int) product;
 	break;
 	
       case OP_MULTU:
-	Mult(registers[instr->rs], registers[instr->rt], FALSE,
-	     &registers[HiReg], &registers[LoReg]);
+	product = (long long) ((unsigned long long)
+			       (unsigned int) registers[instr->rs]
+			       * (unsigned int) registers[instr->rt]);
+	registers[HiReg] = (int) (product >> 32);
+	registers[LoReg] = (int) product;
 	break;
 	
       case OP_NOR:
@@ -384,13 +607,13 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SB:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -456,11 +679,12 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_SUB:	  
-	diff = registers[instr->rs] - registers[instr->rt];
+	diff = (int) ((unsigned int) registers[instr->rs]
+		      - (unsigned int) registers[instr->rt]);
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -472,7 +696,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SW:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -483,7 +707,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = registers[instr->rt];
@@ -502,7 +726,7 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SWR:	  
@@ -513,7 +737,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = (value & 0xffffff) | (registers[instr->rt] << 24);
@@ -529,12 +753,12 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE; 
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -547,7 +771,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -563,6 +787,7 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -625,69 +850,3 @@ Instruction::Decode()
 	}
     }
 }
-
-//----------------------------------------------------------------------
-// Mult
-// 	Simulate R2000 multiplication.
-// 	The words at *hiPtr and *loPtr are overwritten with the
-// 	double-length result of the multiplication.
-//----------------------------------------------------------------------
-
-static void
-Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
-{
-    if ((a == 0) || (b == 0)) {
-	*hiPtr = *loPtr = 0;
-	return;
-    }
-
-    // Compute the sign of the result, then make everything positive
-    // so unsigned computation can be done in the main loop.
-    bool negative = FALSE;
-    if (signedArith) {
-	if (a < 0) {
-	    negative = !negative;
-	    a = -a;
-	}
-	if (b < 0) {
-	    negative = !negative;
-	    b = -b;
-	}
-    }
-
-    // Compute the result in unsigned arithmetic (check a's bits one at
-    // a time, and add in a shifted value of b).
-    unsigned int bLo = b;
-    unsigned int bHi = 0;
-    unsigned int lo = 0;
-    unsigned int hi = 0;
-    for (int i = 0; i < 32; i++) {
-	if (a & 1) {
-	    lo += bLo;
-	    if (lo < bLo)  // Carry out of the low bits?
-		hi += 1;
-	    hi += bHi;
-	    if ((a & 0xfffffffe) == 0)
-		break;
-	}
-	bHi <<= 1;
-	if (bLo & 0x80000000)
-	    bHi |= 1;
-	
-	bLo <<= 1;
-	a >>= 1;
-    }
-
-    // If the result is supposed to be negative, compute the two's
-    // complement of the double-word result.
-    if (negative) {
-	hi = ~hi;
-	lo = ~lo;
-	lo++;
-	if (lo == 0)
-	    hi++;
-    }
-    
-    *hiPtr = (int) hi;
-    *loPtr = (int) lo;
-}
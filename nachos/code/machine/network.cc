@@ -12,9 +12,9 @@
 #include "system.h"
 
 // Dummy functions because C++ can't call member functions indirectly 
-static void NetworkReadPoll(int arg)
+static void NetworkReadPoll(intptr_t arg)
 { Network *net = (Network *)arg; net->CheckPktAvail(); }
-static void NetworkSendDone(int arg)
+static void NetworkSendDone(intptr_t arg)
 { Network *net = (Network *)arg; net->SendDone(); }
 
 // Initialize the network emulation
@@ -22,7 +22,7 @@ static void NetworkSendDone(int arg)
 //   reliability says whether we drop packets to emulate unreliable links
 //   readAvail, writeDone, callArg -- analogous to console
 Network::Network(NetworkAddress addr, double reliability,
-	VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg)
+	VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, intptr_t callArg)
 {
     ident = addr;
     if (reliability < 0) chanceToWork = 0;
@@ -42,7 +42,7 @@ Network::Network(NetworkAddress addr, double reliability,
 						 // in the current directory.
 
     // start polling for incoming packets
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
+    interrupt->Schedule(NetworkReadPoll, (intptr_t) this, NetworkTime, NetworkRecvInt);
 }
 
 Network::~Network()
@@ -58,16 +58,28 @@ void
 Network::CheckPktAvail()
 {
     // schedule the next time to poll for a packet
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
+    interrupt->Schedule(NetworkReadPoll, (intptr_t) this, NetworkTime, NetworkRecvInt);
 
     if (inHdr.length != 0) 	// do nothing if packet is already buffered
 	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
 
-    // otherwise, read packet in
+    // otherwise, read packet in (from the replay log, if a run is
+    // being replayed)
     char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+    if ((replayLog != NULL) && replayLog->IsReplaying()) {
+	if (replayLog->ReplayInput(NetworkRecvInt, buffer, MaxWireSize) == 0) {
+	    delete []buffer;
+	    return;
+	}
+    } else {
+	if (!PollSocket(sock)) {	// do nothing if no packet to be read
+	    delete []buffer;
+	    return;
+	}
+	ReadFromSocket(sock, buffer, MaxWireSize);
+	if (replayLog != NULL)
+	    replayLog->RecordInput(NetworkRecvInt, buffer, MaxWireSize);
+    }
 
     // divide packet into header and data
     inHdr = *(PacketHeader *)buffer;
@@ -108,7 +120,7 @@ Network::Send(PacketHeader hdr, char* data)
 		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
     DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
 
-    interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
+    interrupt->Schedule(NetworkSendDone, (intptr_t) this, NetworkTime, NetworkSendInt);
 
     if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
 	DEBUG('n', "oops, lost it!\n");
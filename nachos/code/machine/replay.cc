@@ -0,0 +1,341 @@
+// replay.cc
+//	Routines to record the interrupts of a run in a log, and to play
+//	the log back.  See replay.h for the format.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "replay.h"
+#include "system.h"
+
+// The kinds of record in a log
+enum { DeliveryRecord, TimerRecord, InputRecord };
+
+//----------------------------------------------------------------------
+// GetNumber
+// 	Decode one variable-length number from a log: seven bits to a
+//	byte, low bits first, with the top bit set in all but the last.
+//	Advance "*pos" past it.
+//----------------------------------------------------------------------
+
+static unsigned
+GetNumber(char *log, int size, int *pos)
+{
+    unsigned number = 0;
+    int shift = 0;
+
+    do {
+	ASSERT(*pos < size);
+	number |= (log[*pos] & 0x7f) << shift;
+	shift += 7;
+    } while (log[(*pos)++] & 0x80);
+    return number;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::ReplayLog
+// 	Start recording a run in a log, or load a log to replay it.
+//
+//	"name" -- the file holding the log
+//	"replay" -- TRUE to replay the log, FALSE to record it
+//----------------------------------------------------------------------
+
+ReplayLog::ReplayLog(char *name, bool replay)
+{
+    int magic = REPLAYMAGIC;
+
+    fileName = name;
+    replaying = replay;
+    deliveries = 0;
+    lastWhen = lastDelivery = 0;
+    buffered = 0;
+    nextDelivery = nextTimer = 0;
+    for (int i = 0; i <= NetworkRecvInt; i++)
+	nextInput[i] = 0;
+    diverged = FALSE;
+    log = NULL;
+    records = NULL;
+    numRecords = 0;
+
+    if (!replaying) {
+	fd = OpenForWrite(fileName);
+	WriteFile(fd, (char *)&magic, sizeof(magic));
+	return;
+    }
+
+    fd = OpenForReadWrite(fileName, FALSE);
+    if (fd < 0) {
+	fprintf(stderr, "Can't open replay log \"%s\"\n", fileName);
+	Abort();
+    }
+    Lseek(fd, 0, SEEK_END);
+    int size = Tell(fd);
+    log = new char[size];
+    Lseek(fd, 0, SEEK_SET);
+    Read(fd, log, size);
+    Close(fd);
+    if ((size < (int) sizeof(magic)) || (*(int *)log != REPLAYMAGIC)) {
+	fprintf(stderr, "\"%s\" is not a replay log\n", fileName);
+	Abort();
+    }
+
+    // Every record takes at least three bytes, which bounds how many
+    // there can be.
+    records = new ReplayRecord[size / 3 + 1];
+    int pos = sizeof(magic);
+    int when = 0, delivery = 0;
+    while (pos < size) {
+	ReplayRecord *record = &records[numRecords++];
+
+	record->kind = log[pos++];
+	when += GetNumber(log, size, &pos);
+	delivery += GetNumber(log, size, &pos);
+	record->when = when;
+	record->delivery = delivery;
+	record->data = NULL;
+	record->length = 0;
+	switch (record->kind) {
+	  case DeliveryRecord:
+	    ASSERT(pos < size);
+	    record->value = log[pos++];
+	    break;
+	  case TimerRecord:
+	    record->value = GetNumber(log, size, &pos);
+	    break;
+	  case InputRecord:
+	    ASSERT(pos < size);
+	    record->value = log[pos++];
+	    record->length = GetNumber(log, size, &pos);
+	    ASSERT((record->length >= 0) && (pos + record->length <= size));
+	    record->data = log + pos;
+	    pos += record->length;
+	    break;
+	  default:
+	    fprintf(stderr, "Bad record in replay log \"%s\"\n", fileName);
+	    Abort();
+	}
+    }
+    DEBUG('i', "Replaying %d records from %s\n", numRecords, fileName);
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::~ReplayLog
+// 	When recording, write out the rest of the log.  When replaying,
+//	say whether the run followed the log all the way through.
+//----------------------------------------------------------------------
+
+ReplayLog::~ReplayLog()
+{
+    if (!replaying) {
+	if (buffered > 0)
+	    WriteFile(fd, buffer, buffered);
+	Close(fd);
+	return;
+    }
+
+    nextDelivery = NextOfKind(nextDelivery, DeliveryRecord, -1);
+    if (diverged && (expectedType < 0))
+	printf("Replay of %s: the %s interrupt at tick %d came after the "
+	       "end of the log\n", fileName, intTypeNames[divergedType],
+	       divergedWhen);
+    else if (diverged)
+	printf("Replay of %s: first differed at tick %d, with the %s "
+	       "interrupt where the log had the %s interrupt at tick %d\n",
+	       fileName, divergedWhen, intTypeNames[divergedType],
+	       intTypeNames[expectedType], expectedWhen);
+    else if (nextDelivery < numRecords)
+	printf("Replay of %s: halted at tick %d, before the end of the log\n",
+	       fileName, stats->totalTicks);
+    else
+	printf("Replay of %s: every interrupt came as logged\n", fileName);
+    delete [] records;
+    delete [] log;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::PutByte, PutNumber
+// 	Add a byte, or a variable-length number (see GetNumber), to the
+//	log being recorded.
+//----------------------------------------------------------------------
+
+void
+ReplayLog::PutByte(int byte)
+{
+    if (buffered == ReplayBufferSize) {
+	WriteFile(fd, buffer, buffered);
+	buffered = 0;
+    }
+    buffer[buffered++] = (char) byte;
+}
+
+void
+ReplayLog::PutNumber(unsigned number)
+{
+    while (number >= 0x80) {
+	PutByte((number & 0x7f) | 0x80);
+	number >>= 7;
+    }
+    PutByte(number);
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::StartRecord
+// 	Start a new record in the log being recorded, with the time and
+//	the number of deliveries since the last one.
+//----------------------------------------------------------------------
+
+void
+ReplayLog::StartRecord(int kind)
+{
+    PutByte(kind);
+    PutNumber(stats->totalTicks - lastWhen);
+    PutNumber(deliveries - lastDelivery);
+    lastWhen = stats->totalTicks;
+    lastDelivery = deliveries;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::NextOfKind
+// 	Return the index of the first record at or after "from" of the
+//	given kind (and, if "type" isn't -1, for that type of interrupt),
+//	or the number of records if there isn't one.
+//----------------------------------------------------------------------
+
+unsigned
+ReplayLog::NextOfKind(unsigned from, int kind, int type)
+{
+    while ((from < numRecords) && ((records[from].kind != kind)
+		|| ((type != -1) && (records[from].value != type))))
+	from++;
+    return from;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::Delivered
+// 	Called by CheckIfDue just before it handles an interrupt.  Count
+//	it, and log it, or check it against the log.  Device polls are
+//	only counted: they happen at fixed intervals, and if they find
+//	anything, RecordInput logs it.
+//
+//	"type" -- the device that caused the interrupt
+//----------------------------------------------------------------------
+
+void
+ReplayLog::Delivered(IntType type)
+{
+    deliveries++;
+    if ((type == ConsoleReadInt) || (type == NetworkRecvInt))
+	return;
+
+    if (!replaying) {
+	StartRecord(DeliveryRecord);
+	PutByte(type);
+	return;
+    }
+
+    nextDelivery = NextOfKind(nextDelivery, DeliveryRecord, -1);
+    if (nextDelivery == numRecords) {
+	if (!diverged) {
+	    diverged = TRUE;
+	    divergedWhen = stats->totalTicks;
+	    divergedType = type;
+	    expectedType = -1;
+	}
+	return;
+    }
+
+    ReplayRecord *record = &records[nextDelivery++];
+    if (!diverged && ((record->value != type)
+		|| (record->when != stats->totalTicks)
+		|| (record->delivery != deliveries))) {
+	DEBUG('i', "Replay differs from the log at delivery %d\n",
+	      deliveries);
+	diverged = TRUE;
+	divergedWhen = stats->totalTicks;
+	divergedType = type;
+	expectedWhen = record->when;
+	expectedType = record->value;
+    }
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::TimerInterval
+// 	Called by the timer each time it sets itself.  When recording,
+//	log the interval; when replaying, return the logged one instead
+//	(or the one given, once the log has run out of them).
+//
+//	"interval" -- the ticks until the next timer interrupt
+//----------------------------------------------------------------------
+
+int
+ReplayLog::TimerInterval(int interval)
+{
+    if (!replaying) {
+	StartRecord(TimerRecord);
+	PutNumber(interval);
+	return interval;
+    }
+
+    nextTimer = NextOfKind(nextTimer, TimerRecord, -1);
+    if (nextTimer == numRecords)
+	return interval;
+    return records[nextTimer++].value;
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::RecordInput
+// 	Log what a device has just read from the host.
+//
+//	"type" -- the device's read interrupt
+//	"data", "size" -- the character or packet it read
+//----------------------------------------------------------------------
+
+void
+ReplayLog::RecordInput(IntType type, char *data, int size)
+{
+    ASSERT(!replaying);
+    StartRecord(InputRecord);
+    PutByte(type);
+    PutNumber(size);
+    for (int i = 0; i < size; i++)
+	PutByte(data[i]);
+}
+
+//----------------------------------------------------------------------
+// ReplayLog::ReplayInput
+// 	Called by a device each time it polls for input, instead of
+//	reading from the host.  If the log has input for this device
+//	that arrived at this poll (or before it, if the kernel has
+//	changed), hand it over.
+//
+//	"type" -- the device's read interrupt
+//	"data", "size" -- where to put the input, and how much room
+//		there is
+//
+//	Returns the number of bytes of input, or 0 if there isn't any yet.
+//----------------------------------------------------------------------
+
+int
+ReplayLog::ReplayInput(IntType type, char *data, int size)
+{
+    ASSERT(replaying);
+    unsigned i = nextInput[type] = NextOfKind(nextInput[type], InputRecord,
+					      type);
+    if (i == numRecords)
+	return 0;
+
+    ReplayRecord *record = &records[i];
+    if ((record->when > stats->totalTicks) || ((record->when ==
+		stats->totalTicks) && (record->delivery > deliveries)))
+	return 0;			// not yet
+
+    int length = record->length;
+    if (length > size)
+	length = size;
+    for (int j = 0; j < length; j++)
+	data[j] = record->data[j];
+    nextInput[type]++;
+    return length;
+}
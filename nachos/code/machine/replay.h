@@ -0,0 +1,112 @@
+// replay.h
+//	Data structures to record the interrupts of a run, and to play
+//	them back later.
+//
+//	A Nachos run depends on more than its programs and flags: with
+//	-rs the timer goes off at (pseudo-)random intervals, and console
+//	and network input arrive whenever the host happens to deliver
+//	them.  With -record <file>, every interrupt delivered (its tick
+//	and its type), every timer interval, and every character or
+//	packet read is written to a compact binary log.  With -replay
+//	<file>, the timer uses the recorded intervals, and the input is
+//	handed to the kernel at the very poll at which it arrived, without
+//	touching the host's; so the run repeats exactly, and once it halts
+//	Nachos says whether every interrupt came as recorded, or where
+//	the two runs first parted.  A kernel that has been changed since
+//	the recording is fed the same timer and input, which is often just
+//	what is wanted when chasing a bug.
+//
+//	The replaying Nachos should be given the same flags as the one
+//	that made the recording, except -rs, which it doesn't need.
+//
+//	The device polls that find nothing to read are counted but not
+//	logged, since they come round at fixed intervals anyway.  Each
+//	record is a kind byte, then the distance in ticks and in
+//	deliveries from the record before, as variable-length numbers:
+//
+//		delivery	type
+//		timer		interval
+//		input		type, length, bytes
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "interrupt.h"
+
+#define REPLAYMAGIC 0x5e91a7	// first word of a replay log
+
+#define ReplayBufferSize 4096	// bytes written to the log at a time
+
+// One logged event, as read back from a log.
+class ReplayRecord {
+  public:
+    int kind;			// delivery, timer or input
+    int when;			// stats->totalTicks at the time
+    int delivery;		// and how many interrupts had been delivered
+    int value;			// the interrupt type, or the timer interval
+    char *data;			// the input, and its length
+    int length;
+};
+
+// The following class defines the log of one run, being either
+// recorded or replayed.
+
+class ReplayLog {
+  public:
+    ReplayLog(char *name, bool replay);	// start recording to, or
+					// replaying from, file "name"
+    ~ReplayLog();			// finish the log, or report how
+					// closely the replay followed it
+
+    bool IsReplaying() { return replaying; }
+
+    void Delivered(IntType type);	// an interrupt of this type is
+					// about to be handled
+    int TimerInterval(int interval);	// the timer's next interval:
+					// record it, or return the
+					// recorded one instead
+    void RecordInput(IntType type, char *data, int size);
+					// a device has read something
+    int ReplayInput(IntType type, char *data, int size);
+					// copy in what the device read at
+					// this poll, if anything; returns
+					// the size, or 0
+
+  private:
+    char *fileName;
+    bool replaying;
+    int deliveries;			// interrupts delivered so far
+    int lastWhen, lastDelivery;		// those of the last record
+
+    // recording
+    int fd;				// the log
+    char buffer[ReplayBufferSize];	// what hasn't been written yet
+    int buffered;
+
+    void PutByte(int byte);
+    void PutNumber(unsigned number);
+    void StartRecord(int kind);
+
+    // replaying
+    char *log;				// the whole log, as read in
+    ReplayRecord *records;		// and decoded
+    unsigned numRecords;
+    unsigned nextDelivery;		// the next of each kind of
+    unsigned nextTimer;			// record still to be matched or
+    unsigned nextInput[NetworkRecvInt + 1];	// used, by device
+    bool diverged;			// whether, and where, the replay
+    int divergedWhen;			// first differed from the log
+    IntType divergedType;
+    int expectedWhen;			// what the log had instead, with
+    int expectedType;			// type -1 if it had come to an end
+
+    unsigned NextOfKind(unsigned from, int kind, int type);
+};
+
+#endif // REPLAY_H
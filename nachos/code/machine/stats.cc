@@ -23,6 +23,18 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPagesShared = numPagesCopied = 0;
+    numCodeMappingsShared = 0;
+    numEvictions = numDirtyWritebacks = 0;
+    numSwapClusters = numCleanerWrites = numWritebackWaits = 0;
+    numSwapReads = 0;
+    numFramesAllocated = numFramesFreed = maxFramesInUse = 0;
+    unusedFrameBytes = maxUnusedFrameBytes = 0;
+    pageTableEntries = maxPageTableEntries = pageTableBytes = 0;
+    numPageTableLookups = numPageTableProbes = 0;
+    numBlocksCached = numCachedInstrs = numFusedPairs = 0;
+    numICacheHits = numICacheMisses = numDCacheHits = numDCacheMisses = 0;
+    numTLBHits = numTLBMisses = 0;
 }
 
 //----------------------------------------------------------------------
@@ -37,13 +49,17 @@ Statistics::Print()
     printf("Total threads = %d\n",thread_count );
     printf("Total CPU Busy Time = %d\n", total_burst );
     printf("Total CPU Execution Time = %d\n", totalTicks - system_start_time);
-    printf("CPU Utilisation = %d\n",((total_burst)*100)/(totalTicks - system_start_time) );
+    printf("CPU Utilisation = %d\n",(totalTicks > system_start_time) ?
+	((total_burst)*100)/(totalTicks - system_start_time) : 0);
     printf("Max Burst = %d\n", total_max_burst);
     printf("Min Burst = %d\n", total_min_burst);
-    printf("Average Burst = %d\n", total_burst/total_burst_count);
+    printf("Average Burst = %d\n", (total_burst_count > 0) ?
+	total_burst/total_burst_count : 0);
     printf("Total Nummber of burst = %d\n",total_burst_count );
-    printf("Average Ready Queue Wait Time = %d\n", total_ready_queue_waittime/thread_count );
-    printf("Average Thread Completion Time = %d\n", total_thread_time/thread_count);
+    printf("Average Ready Queue Wait Time = %d\n", (thread_count > 0) ?
+	total_ready_queue_waittime/thread_count : 0);
+    printf("Average Thread Completion Time = %d\n", (thread_count > 0) ?
+	total_thread_time/thread_count : 0);
     printf("Max Thread Completion Time = %d\n",total_max_thread_time);
     printf("Min Thread Completion Time = %d\n", total_min_thread_time);
 
@@ -54,6 +70,61 @@ Statistics::Print()
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
+#ifdef VM
+    printf("Replacement (%s): evictions %d, dirty writebacks %d\n",
+	frameTable->PolicyName(), numEvictions, numDirtyWritebacks);
+    if ((numDirtyWritebacks > 0) || (numSwapReads > 0))
+	printf("Swap: pages written %d in %d clusters (%d by the page "
+	    "cleaner), read %d; %d evictions waited for a writeback\n",
+	    numDirtyWritebacks, numSwapClusters, numCleanerWrites,
+	    numSwapReads, numWritebackWaits);
+#endif
+#ifdef USER_PROGRAM
+    if (numFramesAllocated > 0) {
+	printf("Memory: frames allocated %d, freed %d, at most %d of %d in "
+	    "use\n", numFramesAllocated, numFramesFreed, maxFramesInUse,
+	    NumPhysPages);
+	printf("Fragmentation: at most %d bytes (%d%%) of the frames in use "
+	    "unused\n", maxUnusedFrameBytes,
+	    (100 * maxUnusedFrameBytes) / (maxFramesInUse * PageSize));
+    }
+#ifdef INVERTED_PAGE_TABLE
+    if (maxPageTableEntries > 0)
+	printf("Page tables: %d-byte pages, inverted, at most %d entries "
+	    "in use (%d bytes allocated)\n", PageSize, maxPageTableEntries,
+	    pageTableBytes);
+#else
+    if (maxPageTableEntries > 0)
+	printf("Page tables: %d-byte pages, at most %d entries (%d bytes) "
+	    "in use\n", PageSize, maxPageTableEntries,
+	    maxPageTableEntries * (int) sizeof(TranslationEntry));
+#endif
+#endif
+#ifdef VM
+    if (numPageTableLookups > 0)
+	printf("Page table lookups: %d, %.2f probes each\n",
+	    numPageTableLookups,
+	    (double) numPageTableProbes / numPageTableLookups);
+#endif
+    if (numPagesShared > 0)
+	printf("Copy-on-write: pages shared %d, copied %d\n", numPagesShared,
+	    numPagesCopied);
+    if (numCodeMappingsShared > 0)
+	printf("Shared code mappings: %d\n", numCodeMappingsShared);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+    if (numBlocksCached > 0) {
+	printf("Block cache: blocks %d, instructions %d\n",
+	    numBlocksCached, numCachedInstrs);
+	printf("Fusion: pairs %d, %d%% of user instructions\n", numFusedPairs,
+	    (userTicks > 0) ? (int) ((200.0 * numFusedPairs) / userTicks) : 0);
+    }
+    if (numICacheHits + numICacheMisses > 0)
+	printf("I-cache: hits %d, misses %d\n", numICacheHits,
+	    numICacheMisses);
+    if (numDCacheHits + numDCacheMisses > 0)
+	printf("D-cache: hits %d, misses %d\n", numDCacheHits,
+	    numDCacheMisses);
+    if (numTLBHits + numTLBMisses > 0)
+	printf("TLB: hits %d, misses %d\n", numTLBHits, numTLBMisses);
 }
@@ -26,15 +26,55 @@ class Statistics {
     int systemTicks;	 	// Time spent executing system code
     int userTicks;       	// Time spent executing user code
 				// (this is also equal to # of
-				// user instructions executed)
+				// user instructions executed, unless
+				// we're modelling caches: then it
+				// includes the time stalled on misses)
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPagesShared;		// pages a fork shared rather than copied
+    int numPagesCopied;		// shared pages copied when written
+    int numCodeMappingsShared;	// times a code page was mapped to a
+				// frame that another process running
+				// the same program had read it into
+    int numEvictions;		// pages taken out of memory to make room
+    int numDirtyWritebacks;	// dirty pages written to swap
+    int numSwapClusters;	// ... in this many writes of adjacent pages
+    int numCleanerWrites;	// ... of which the page cleaner wrote
+    int numWritebackWaits;	// evictions that had to wait for their
+				// victim to be written out
+    int numSwapReads;		// pages read back in from swap
+    int numFramesAllocated;	// number of physical frames handed out
+    int numFramesFreed;		// ... and given back
+    int maxFramesInUse;		// most physical frames in use at once
+    int unusedFrameBytes;	// bytes of allocated memory past the end
+				// of the address spaces, which are
+				// rounded up to whole pages
+    int maxUnusedFrameBytes;	// ... at most
+    int pageTableEntries;	// entries in the page tables of the
+				// address spaces in use
+    int maxPageTableEntries;	// ... at most
+    int pageTableBytes;		// memory allocated to the inverted page
+				// table, if there is one
+    int numPageTableLookups;	// number of pages looked up in page tables
+    int numPageTableProbes;	// ... and the table entries (and hash
+				// anchors) read to find them
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numBlocksCached;	// number of hot blocks pre-decoded
+    int numCachedInstrs;	// number of user instructions run out of
+				// the block cache
+    int numFusedPairs;		// number of instruction pairs run as a
+				// single superinstruction
+    int numICacheHits;		// number of instruction fetches that hit
+    int numICacheMisses;	// ... or missed in the instruction cache
+    int numDCacheHits;		// number of loads and stores that hit
+    int numDCacheMisses;	// ... or missed in the data cache
+    int numTLBHits;		// number of translations found in the TLB
+    int numTLBMisses;		// ... or not, and loaded by the kernel
 
     Statistics(); 		// initialize everything to zero
 
@@ -56,5 +96,6 @@ class Statistics {
 #define ConsoleTime 	100	// time to read or write one character
 #define NetworkTime 	100   	// time to send or receive one packet
 #define TimerTicks 	100    	// (average) time between timer interrupts
+#define CacheMissTicks	10	// time to fill a cache line from memory
 
 #endif // STATS_H
@@ -35,7 +35,8 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
-#ifdef HOST_i386
+#include <sys/stat.h>
+#if defined(HOST_i386) || defined(HOST_x86_64)
 #include <sys/time.h>
 #endif
 #ifdef HOST_SPARC
@@ -56,7 +57,7 @@ extern "C" {
 //int creat(const char *name, unsigned short mode);
 int open(const char *name, int flags, ...);
 // void signal(int sig, VoidFunctionPtr func); -- this may work now!
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
 int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
              struct timeval *timeout);
 #else
@@ -79,8 +80,6 @@ int close(int filedes);
 // extern int sendto(int s, void *msg, int len, int flags, void *to, int tolen);
 
 
-void srand(unsigned seed);
-int rand(void);
 unsigned sleep(unsigned);
 void abort();
 //void exit();
@@ -126,7 +125,7 @@ PollFile(int fd)
         pollTime.tv_usec = 0;                 	// no delay
 
 // poll file or socket
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
     retVal = select(32, (fd_set*)&rfd, (fd_set*)&wfd, (fd_set*)&xfd, &pollTime);
 #else
     retVal = select(32, &rfd, &wfd, &xfd, &pollTime);
@@ -229,13 +228,61 @@ Lseek(int fd, int offset, int whence)
 int 
 Tell(int fd)
 {
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
     return lseek(fd,0,SEEK_CUR); // 386BSD doesn't have the tell() system call
 #else
     return tell(fd);
 #endif
 }
 
+//----------------------------------------------------------------------
+// SameFile
+// 	Check whether two open files are the same file: the same inode
+//	on the same device, with the same size and modification time.
+//----------------------------------------------------------------------
+
+bool
+SameFile(int fd1, int fd2)
+{
+    struct stat stat1, stat2;
+
+    if ((fstat(fd1, &stat1) < 0) || (fstat(fd2, &stat2) < 0))
+	return FALSE;
+    return (stat1.st_dev == stat2.st_dev) && (stat1.st_ino == stat2.st_ino)
+	&& (stat1.st_size == stat2.st_size)
+	&& (stat1.st_mtime == stat2.st_mtime);
+}
+
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "length" bytes of an open file into our memory,
+//	read-only.  Return NULL if the file can't be mapped, in which
+//	case it can still be read with Read or ReadPartial.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int length)
+{
+    void *addr;
+
+    if (length <= 0)
+	return NULL;
+    addr = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    return (addr == MAP_FAILED) ? NULL : (char *) addr;
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Undo MapFile.  Abort on error.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *addr, int length)
+{
+    int retVal = munmap(addr, length);
+    ASSERT(retVal >= 0);
+}
+
 
 //----------------------------------------------------------------------
 // Close
@@ -260,6 +307,30 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// TemporaryName
+// 	Return a name, in the host's directory for temporary files, that
+//	no file has.  The caller creates the file, and can unlink it as
+//	soon as it is open, so that it goes away with Nachos, and other
+//	simulations running at the same time each get a file of their own.
+//
+//	"prefix" -- the start of the name
+//----------------------------------------------------------------------
+
+char *
+TemporaryName(char *prefix)
+{
+    char *name = new char[strlen(P_tmpdir) + strlen(prefix) + 8];
+    int fd;
+
+    sprintf(name, "%s/%sXXXXXX", P_tmpdir, prefix);
+    fd = mkstemp(name);
+    ASSERT(fd >= 0);
+    close(fd);
+    unlink(name);
+    return name;
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now, 
@@ -391,7 +462,7 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
 void 
 CallOnUserAbort(VoidNoArgFunctionPtr func)
 {
-    (void)signal(SIGINT, (VoidFunctionPtr) func);
+    (void)signal(SIGINT, (void (*)(int)) func);
 }
 
 //----------------------------------------------------------------------
@@ -431,25 +502,40 @@ Exit(int exitCode)
 
 //----------------------------------------------------------------------
 // RandomInit
-// 	Initialize the pseudo-random number generator.  We use the
-//	now obsolete "srand" and "rand" because they are more portable!
+// 	Initialize the pseudo-random number generator.  We used to use
+//	"srand" and "rand", but their state is shared by the whole UNIX
+//	process, and each simulation needs its own; so each host thread
+//	gets its own generator.  random_r, given the same 128 bytes of
+//	state, produces exactly the sequence rand() did.
 //----------------------------------------------------------------------
 
+static thread_local struct random_data randomData;
+static thread_local char randomState[128];
+static thread_local bool randomReady = FALSE;
+
 void 
 RandomInit(unsigned seed)
 {
-    srand(seed);
+    memset(&randomData, 0, sizeof(randomData));
+    initstate_r(seed, randomState, sizeof(randomState), &randomData);
+    randomReady = TRUE;
 }
 
 //----------------------------------------------------------------------
 // Random
-// 	Return a pseudo-random number.
+// 	Return a pseudo-random number.  Like rand(), it starts as if
+//	seeded with 1.
 //----------------------------------------------------------------------
 
 int 
 Random()
 {
-    return rand();
+    int32_t result;
+
+    if (!randomReady)
+	RandomInit(1);
+    random_r(&randomData, &result);
+    return result;
 }
 
 //----------------------------------------------------------------------
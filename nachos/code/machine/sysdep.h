@@ -26,8 +26,12 @@ extern int ReadPartial(int fd, char *buffer, int nBytes);
 extern void WriteFile(int fd, char *buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
 extern int Tell(int fd);
+extern bool SameFile(int fd1, int fd2);
+extern char *MapFile(int fd, int length);
+extern void UnmapFile(char *addr, int length);
 extern void Close(int fd);
 extern bool Unlink(char *name);
+extern char *TemporaryName(char *prefix);
 
 // Interprocess communication operations, for simulating the network
 extern int OpenSocket();
@@ -58,10 +62,7 @@ extern void DeallocBoundedArray(char *p, int size);
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
-int atoi(const char *str);
-double atof(const char *str);
-int abs(int i);
-
+#include <stdlib.h>		// for atoi, atof, abs
 #include <stdio.h>		// for printf, fprintf
 #include <string.h>		// for DEBUG, etc.
 }
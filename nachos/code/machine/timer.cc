@@ -24,7 +24,7 @@
 #include "system.h"
 
 // dummy function because C++ does not allow pointers to member functions
-static void TimerHandler(int arg)
+static void TimerHandler(intptr_t arg)
 { Timer *p = (Timer *)arg; p->TimerExpired(); }
 
 //----------------------------------------------------------------------
@@ -41,14 +41,14 @@ static void TimerHandler(int arg)
 //		at random, instead of fixed, intervals.
 //----------------------------------------------------------------------
 
-Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom)
+Timer::Timer(VoidFunctionPtr timerHandler, intptr_t callArg, bool doRandom)
 {
     randomize = doRandom;
     handler = timerHandler;
     arg = callArg; 
 
     // schedule the first interrupt from the timer device
-    interrupt->Schedule(TimerHandler, (int) this, TimeOfNextInterrupt(), 
+    interrupt->Schedule(TimerHandler, (intptr_t) this, TimeOfNextInterrupt(), 
 		TimerInt); 
 }
 
@@ -62,24 +62,44 @@ void
 Timer::TimerExpired() 
 {
     // schedule the next timer device interrupt
-    interrupt->Schedule(TimerHandler, (int) this, TimeOfNextInterrupt(), 
+    interrupt->Schedule(TimerHandler, (intptr_t) this, TimeOfNextInterrupt(), 
 		TimerInt);
 
     // invoke the Nachos interrupt handler for this device
     (*handler)(arg);
 }
 
+//----------------------------------------------------------------------
+// Timer::ResumeInterrupt
+//      Re-schedule the timer interrupt saved in a checkpoint, to happen
+//	at time "when".
+//----------------------------------------------------------------------
+
+void
+Timer::ResumeInterrupt(int when)
+{
+    interrupt->Schedule(TimerHandler, (intptr_t) this, 
+		when - stats->totalTicks, TimerInt);
+}
+
 //----------------------------------------------------------------------
 // Timer::TimeOfNextInterrupt
 //      Return when the hardware timer device will next cause an interrupt.
 //	If randomize is turned on, make it a (pseudo-)random delay.
+//	When a run is being recorded or replayed, the replay log gets
+//	the final say.
 //----------------------------------------------------------------------
 
 int 
 Timer::TimeOfNextInterrupt() 
 {
+    int interval;
+
     if (randomize)
-	return 1 + (Random() % (TimerTicks * 2));
+	interval = 1 + (Random() % (TimerTicks * 2));
     else
-	return TimerTicks; 
+	interval = TimerTicks; 
+    if (replayLog != NULL)
+	interval = replayLog->TimerInterval(interval);
+    return interval;
 }
@@ -26,7 +26,7 @@
 // The following class defines a hardware timer. 
 class Timer {
   public:
-    Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom);
+    Timer(VoidFunctionPtr timerHandler, intptr_t callArg, bool doRandom);
 				// Initialize the timer, to call the interrupt
 				// handler "timerHandler" every time slice.
     ~Timer() {}
@@ -39,10 +39,13 @@ class Timer {
     int TimeOfNextInterrupt();  // figure out when the timer will generate
 				// its next interrupt 
 
+    void ResumeInterrupt(int when);  // re-schedule an interrupt that was
+				// pending at time "when" in a checkpoint
+
   private:
     bool randomize;		// set if we need to use a random timeout delay
     VoidFunctionPtr handler;	// timer interrupt handler 
-    int arg;			// argument to pass to interrupt handler
+    intptr_t arg;		// argument to pass to interrupt handler
 
 };
 
@@ -13,6 +13,8 @@
 //	to find an entry with the same virtual page #.  If found,
 //	this entry is used for the translation.
 //	If not, it traps to software with an exception. 
+//	Only one set of the table is searched, chosen by hashing the
+//	virtual page # and the ID of the running address space.
 //
 //	In practice, the TLB is much smaller than the amount of physical
 //	memory (16 entries is common on a machine that has 1000's of
@@ -21,7 +23,9 @@
 //	anything at all about that.
 //
 //	Note that the contents of the TLB are specific to an address space.
-//	If the address space changes, so does the contents of the TLB!
+//	Each entry is tagged with the address space it belongs to, so
+//	that entries for different address spaces can be in the TLB at
+//	the same time; see Machine::LoadTLB.
 //
 // DO NOT CHANGE -- part of the machine emulation
 //
@@ -32,6 +36,8 @@
 #include "copyright.h"
 #include "machine.h"
 #include "addrspace.h"
+#include "blockcache.h"
+#include "cache.h"
 #include "system.h"
 
 // Routines for converting Words and Short Words to and from the
@@ -71,6 +77,167 @@ unsigned short
 ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 
 
+//----------------------------------------------------------------------
+// Machine::FlushHostTLB
+//	Forget every translation in the host TLB.  The kernel must call
+//	this whenever it changes which page table is in use, or changes
+//	an entry in the current page table or the TLB.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushHostTLB()
+{
+    if (hostTLB == NULL)
+	return;
+    for (int i = 0; i < HostTLBSize; i++)
+	hostTLB[i].valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Machine::ForgetHostTranslation
+//	Forget the host TLB's translation of one virtual page, if it has
+//	one, because its TLB entry has changed or gone.
+//----------------------------------------------------------------------
+
+void
+Machine::ForgetHostTranslation(unsigned int vpn)
+{
+    HostTLBEntry *entry;
+
+    if (hostTLB == NULL)
+	return;
+    entry = &hostTLB[vpn & (HostTLBSize - 1)];
+    if (entry->virtualPage == vpn)
+	entry->valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Machine::TLBSet
+//	Find the set of TLB entries that may hold the translation of a
+//	virtual page for an address space.  The address space ID is
+//	mixed into the hash, so that processes running the same program
+//	don't all compete for the same sets.
+//
+//	Returns the index of the first entry in the set.
+//
+//	"vpn" -- the virtual page
+//	"asid" -- the address space
+//----------------------------------------------------------------------
+
+int
+Machine::TLBSet(unsigned int vpn, int asid)
+{
+    unsigned int hash = vpn ^ ((unsigned) asid * 2654435761u);
+
+    return (hash % (tlbSize / tlbWays)) * tlbWays;
+}
+
+//----------------------------------------------------------------------
+// Machine::LoadTLB
+//	Put a translation in the TLB, for the address space that is
+//	running.  It replaces the entry already there for the same page,
+//	if any, or else a free entry in its set, or else the entries of
+//	the set in turn.
+//
+//	Entries of address spaces that have gone are never matched again,
+//	and are simply replaced in their turn, since address space IDs
+//	aren't reused.
+//
+//	"entry" -- the translation, which is copied
+//----------------------------------------------------------------------
+
+void
+Machine::LoadTLB(TranslationEntry *entry)
+{
+    int set = TLBSet(entry->virtualPage, currentASID);
+    int i, way = -1;
+
+    ASSERT(tlb != NULL);
+    for (i = set; (way == -1) && (i < set + tlbWays); i++)
+	if (tlb[i].valid && (tlb[i].virtualPage == entry->virtualPage)
+			 && (tlbASID[i] == currentASID))
+	    way = i;
+    for (i = set; (way == -1) && (i < set + tlbWays); i++)
+	if (!tlb[i].valid)
+	    way = i;
+    if (way == -1) {
+	way = set + tlbNext[set / tlbWays];
+	tlbNext[set / tlbWays] = (tlbNext[set / tlbWays] + 1) % tlbWays;
+    }
+    DEBUG('a', "Loading TLB entry %d: virtual page %d, frame %d\n", way,
+	  entry->virtualPage, entry->physicalPage);
+    if (tlb[way].valid && (tlbASID[way] == currentASID))
+	ForgetHostTranslation(tlb[way].virtualPage);
+    ForgetHostTranslation(entry->virtualPage);
+    tlb[way] = *entry;
+    tlbASID[way] = currentASID;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateTLBEntry, FlushTLB
+//	Drop the TLB entry for one page of an address space, or all of
+//	the address space's entries, after the kernel has changed its
+//	page table.
+//
+//	"asid" -- the address space
+//	"vpn" -- the virtual page
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateTLBEntry(int asid, int vpn)
+{
+    int set = TLBSet(vpn, asid);
+
+    for (int i = set; i < set + tlbWays; i++)
+	if (tlb[i].valid && (tlb[i].virtualPage == vpn)
+			 && (tlbASID[i] == asid))
+	    tlb[i].valid = FALSE;
+    if (asid == currentASID)
+	ForgetHostTranslation(vpn);
+}
+
+void
+Machine::FlushTLB(int asid)
+{
+    for (int i = 0; i < tlbSize; i++)
+	if (tlbASID[i] == asid)
+	    tlb[i].valid = FALSE;
+    if (asid == currentASID)
+	FlushHostTLB();
+}
+
+//----------------------------------------------------------------------
+// Machine::HostAddress
+//	Look for "virtAddr" in the host TLB.  On a hit, the access needs
+//	no further checking: the address is aligned, the page is mapped,
+//	and Translate has already set the use (and for stores, dirty)
+//	bits of its page table or TLB entry.
+//
+//	Returns a pointer to the byte in mainMemory, or NULL if the access
+//	has to go through Machine::Translate.
+//
+//	"virtAddr" -- the virtual address to look up
+//	"size" -- the amount of memory being read or written
+// 	"writing" -- if TRUE, the entry must allow stores
+//----------------------------------------------------------------------
+
+char *
+Machine::HostAddress(int virtAddr, int size, bool writing)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    HostTLBEntry *entry;
+
+    if ((hostTLB == NULL) || (virtAddr & (size - 1)))
+	return NULL;
+    entry = &hostTLB[vpn & (HostTLBSize - 1)];
+    if (!entry->valid || (entry->virtualPage != vpn)
+			|| (writing && !entry->writable))
+	return NULL;
+    if (tlb != NULL)
+	stats->numTLBHits++;		// the TLB would have hit too
+    return entry->page + (unsigned) virtAddr % PageSize;
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadMem
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into 
@@ -82,36 +249,52 @@ ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 //	"addr" -- the virtual address to read from
 //	"size" -- the number of bytes to read (1, 2, or 4)
 //	"value" -- the place to write the result
+//	"cache" -- the cache to go through, or NULL
+//
+//	Halfwords and words are copied out of mainMemory with memcpy,
+//	rather than through an (int *) cast, so that the compiler can't
+//	assume they don't overlap other objects when optimizing.  At -O2
+//	each memcpy is a single move.
 //----------------------------------------------------------------------
 
 bool
-Machine::ReadMem(int addr, int size, int *value)
+Machine::ReadMem(int addr, int size, int *value, Cache *cache)
 {
     int data;
     ExceptionType exception;
     int physicalAddress;
+    char *location;
     
-    DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
+    location = HostAddress(addr, size, FALSE);
+    if (location == NULL) {
+	DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+	exception = Translate(addr, &physicalAddress, size, FALSE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	location = &machine->mainMemory[physicalAddress];
+	CacheHostAddress(addr, location, FALSE);
     }
+    if (cache != NULL)
+	CacheAccess(cache, location);
     switch (size) {
       case 1:
-	data = machine->mainMemory[physicalAddress];
+	data = *location;
 	*value = data;
 	break;
 	
       case 2:
-	data = *(unsigned short *) &machine->mainMemory[physicalAddress];
-	*value = ShortToHost(data);
+	{ unsigned short half;
+	  memcpy(&half, location, sizeof(half));
+	  *value = ShortToHost(half); }
 	break;
 	
       case 4:
-	data = *(unsigned int *) &machine->mainMemory[physicalAddress];
-	*value = WordToHost(data);
+	{ unsigned int word;
+	  memcpy(&word, location, sizeof(word));
+	  *value = WordToHost(word); }
 	break;
 
       default: ASSERT(FALSE);
@@ -139,35 +322,108 @@ Machine::WriteMem(int addr, int size, int value)
 {
     ExceptionType exception;
     int physicalAddress;
+    char *location;
      
-    DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+    location = HostAddress(addr, size, TRUE);
+    if (location == NULL) {
+	DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+	exception = Translate(addr, &physicalAddress, size, TRUE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	location = &machine->mainMemory[physicalAddress];
+	CacheHostAddress(addr, location, TRUE);
     }
+    if (dcache != NULL)
+	CacheAccess(dcache, location);
     switch (size) {
       case 1:
-	machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
+	*location = (unsigned char) (value & 0xff);
 	break;
 
       case 2:
-	*(unsigned short *) &machine->mainMemory[physicalAddress]
-		= ShortToMachine((unsigned short) (value & 0xffff));
+	{ unsigned short half = ShortToMachine((unsigned short) (value & 0xffff));
+	  memcpy(location, &half, sizeof(half)); }
 	break;
       
       case 4:
-	*(unsigned int *) &machine->mainMemory[physicalAddress]
-		= WordToMachine((unsigned int) value);
+	{ unsigned int word = WordToMachine((unsigned int) value);
+	  memcpy(location, &word, sizeof(word)); }
 	break;
 	
       default: ASSERT(FALSE);
     }
+    if (blockCache != NULL)
+	blockCache->InvalidatePage((location - mainMemory) / PageSize);
     
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::CacheHostAddress
+//	Remember the translation Machine::Translate just made for
+//	"virtAddr", so later accesses to the page can skip it.  Only
+//	a store makes the entry writable, since the first store to a
+//	page has to go through Translate to set the dirty bit.
+//
+//	"virtAddr" -- the virtual address that was translated
+//	"location" -- where it turned out to be in mainMemory
+// 	"writing" -- TRUE if the access was a store
+//----------------------------------------------------------------------
+
+void
+Machine::CacheHostAddress(int virtAddr, char *location, bool writing)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    HostTLBEntry *entry;
+
+    if (hostTLB == NULL)
+	return;
+    entry = &hostTLB[vpn & (HostTLBSize - 1)];
+    entry->valid = TRUE;
+    entry->virtualPage = vpn;
+    entry->page = location - (unsigned) virtAddr % PageSize;
+    entry->writable = writing;
+}
+
+//----------------------------------------------------------------------
+// Machine::CacheAccess
+//	Look up a memory access in the instruction or data cache.  A miss
+//	stalls the machine for CacheMissTicks, which is charged to user or
+//	system time depending on who made the access (the kernel reads
+//	user memory for some system calls).
+//
+//	"cache" -- the cache to look in
+//	"location" -- the byte being accessed, in mainMemory
+//----------------------------------------------------------------------
+
+void
+Machine::CacheAccess(Cache *cache, char *location)
+{
+    bool hit = cache->Access(location - mainMemory);
+
+    if (cache == icache) {
+	if (hit)
+	    stats->numICacheHits++;
+	else
+	    stats->numICacheMisses++;
+    } else {
+	if (hit)
+	    stats->numDCacheHits++;
+	else
+	    stats->numDCacheMisses++;
+    }
+    if (!hit) {
+	stats->totalTicks += CacheMissTicks;
+	if (interrupt->getStatus() == SystemMode)
+	    stats->systemTicks += CacheMissTicks;
+	else
+	    stats->userTicks += CacheMissTicks;
+    }
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -186,7 +442,7 @@ Machine::WriteMem(int addr, int size, int value)
 ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
-    int i;
+    int i, set;
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
@@ -220,8 +476,10 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	}
 	entry = &NachOSpageTable[vpn];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
+	set = TLBSet(vpn, currentASID);
+        for (entry = NULL, i = set; i < set + tlbWays; i++)
+    	    if (tlb[i].valid && ((unsigned) tlb[i].virtualPage == vpn)
+			     && (tlbASID[i] == currentASID)) {
 		entry = &tlb[i];			// FOUND!
 		break;
 	    }
@@ -231,6 +489,8 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	stats->numTLBHits++;			// (misses are counted by the
+						// kernel, which handles them)
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
@@ -241,7 +501,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
-    if (pageFrame >= NumPhysPages) { 
+    if (pageFrame >= (unsigned) NumPhysPages) { 
 	DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
 	return BusErrorException;
     }
@@ -273,7 +533,7 @@ Machine::GetPA (unsigned vaddr)
    if ((vpn < NachOSpageTableSize) && NachOSpageTable[vpn].valid) {
       entry = &NachOSpageTable[vpn];
       pageFrame = entry->physicalPage;
-      if (pageFrame >= NumPhysPages) return -1;
+      if (pageFrame >= (unsigned) NumPhysPages) return -1;
       return pageFrame * PageSize + offset;
    }
    else return -1;
@@ -42,4 +42,23 @@ class TranslationEntry {
 			// page is modified.
 };
 
+// The following class defines an entry in the simulator's own cache of
+// recent translations, used to speed up ReadMem and WriteMem.  Unlike
+// the TLB above, this cache is not visible to the Nachos kernel, and it
+// holds a host pointer to the start of the page in "mainMemory"
+// rather than a physical page number.
+//
+// An entry is only made after Machine::Translate has succeeded (and so
+// set the use bit), and it is only marked writable after a successful
+// write (which set the dirty bit), so using it never changes what the
+// kernel sees in its page table or TLB.
+
+class HostTLBEntry {
+  public:
+    bool valid;		// Is this entry in use?
+    unsigned int virtualPage; // The page number in virtual memory.
+    char *page;		// Where that page lives in "mainMemory".
+    bool writable;	// Can stores to the page use this entry?
+};
+
 #endif
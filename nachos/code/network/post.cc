@@ -145,11 +145,11 @@ MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data)
 //	"arg" -- pointer to the Post Office managing the Network
 //----------------------------------------------------------------------
 
-static void PostalHelper(int arg)
+static void PostalHelper(intptr_t arg)
 { PostOffice* po = (PostOffice *) arg; po->PostalDelivery(); }
-static void ReadAvail(int arg)
+static void ReadAvail(intptr_t arg)
 { PostOffice* po = (PostOffice *) arg; po->IncomingPacket(); }
-static void WriteDone(int arg)
+static void WriteDone(intptr_t arg)
 { PostOffice* po = (PostOffice *) arg; po->PacketSent(); }
 
 //----------------------------------------------------------------------
@@ -184,14 +184,14 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
     boxes = new MailBox[nBoxes];
 
 // Third, initialize the network; tell it which interrupt handlers to call
-    network = new Network(addr, reliability, ReadAvail, WriteDone, (int) this);
+    network = new Network(addr, reliability, ReadAvail, WriteDone, (intptr_t) this);
 
 
 // Finally, create a thread whose sole job is to wait for incoming messages,
 //   and put them in the right mailbox. 
     NachOSThread *t = new NachOSThread("postal worker");
 
-    t->ThreadFork(PostalHelper, (int) this);
+    t->ThreadFork(PostalHelper, (intptr_t) this);
 }
 
 //----------------------------------------------------------------------
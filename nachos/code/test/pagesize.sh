@@ -0,0 +1,105 @@
+#!/bin/bash
+# pagesize.sh
+#	Run batch files under the vm build with a range of page sizes,
+#	keeping the size of main memory the same, and tabulate what the
+#	page size costs:
+#
+#		frames			frames of main memory (-mem)
+#		ptentries ptbytes	the most page table entries in use
+#					at once, and the memory they take
+#					(with INVERTED_PAGE_TABLE, the
+#					memory allocated for the table)
+#		faults faults/1k	page faults, in all and per thousand
+#					user instructions
+#		tlbmiss miss/1k		TLB misses, likewise: the cost of
+#					translation, since each one is
+#					handled by the kernel
+#		user			user ticks
+#		secs			host time for the run
+#
+#	The table is tab-separated, so it can be fed to a spreadsheet or
+#	to "column -t".  The runs are made one at a time, so that their
+#	host times can be compared.  Runs that fail or time out are
+#	reported, and left out of the table.
+#
+#	Usage, from the test directory, once vm/nachos is built:
+#
+#	    ./pagesize.sh [-p "<page sizes>"] [-m <memory bytes>]
+#		[-x "<nachos flags>"] <batch file> ...
+#
+#	The defaults are -p "32 64 128 256 512 1024 2048" -m 65536 (the
+#	512 frames of 128 bytes that Nachos has by default).  For
+#	instance,
+#
+#	    ./pagesize.sh -m 8192 -x "-pr aging" B4.txt
+#
+#	compares the page sizes when memory is short.
+#
+# Copyright (c) 1992-1993 The Regents of the University of California.
+# All rights reserved.  See copyright.h for copyright notice and limitation
+# of liability and disclaimer of warranty provisions.
+
+TIMEOUT=${TIMEOUT:-120}
+
+CODE=$(cd "$(dirname "$0")/.." && pwd)
+NACHOS=$CODE/vm/nachos
+
+sizes="32 64 128 256 512 1024 2048"
+memory=65536
+FLAGS=
+while getopts "p:m:x:" opt; do
+    case $opt in
+      p) sizes=$OPTARG ;;
+      m) memory=$OPTARG ;;
+      x) FLAGS=$OPTARG ;;
+      *) echo "usage: $0 [-p page sizes] [-m memory bytes] [-x flags]" \
+	      "batch ..." >&2
+	 exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+if [ $# -eq 0 ]; then
+    echo "pagesize: no batch files given" >&2
+    exit 2
+fi
+if [ ! -x $NACHOS ]; then
+    echo "pagesize: build $NACHOS first" >&2
+    exit 2
+fi
+
+printf "batch\tpagesize\tframes\tptentries\tptbytes\tfaults\tfaults/1k"
+printf "\ttlbmiss\tmiss/1k\tuser\tsecs\n"
+for batch in "$@"; do
+    batch=$(cd "$(dirname "$batch")" && pwd)/$(basename "$batch")
+    for size in $sizes; do
+	frames=$((memory / size))
+	start=$(date +%s.%N)
+
+	# Nachos polls the console, so stdin has to stay open (and empty)
+	# until the run is over; hence the sleep.
+	out=$(cd $CODE/test && timeout $TIMEOUT $NACHOS $FLAGS -ps $size \
+		  -mem $frames -F $batch < <(sleep $TIMEOUT 2> /dev/null) 2>&1)
+	end=$(date +%s.%N)
+	echo "$out" | awk -v run="$batch	$size	$frames" \
+			  -v start=$start -v end=$end '
+	    /^Ticks: total/	{ gsub(",", ""); user = $9; halted = 1 }
+	    /^Paging: faults/	{ faults = $NF }
+	    /^Page tables:/	{ for (i = 2; i <= NF; i++) {
+				      if ($i == "entries")
+					  entries = $(i - 1)
+				      if ($i ~ /^\(/)
+					  bytes = substr($i, 2)
+				  }
+				}
+	    /^TLB: hits/	{ misses = $NF }
+	    END {
+		if (!halted) {
+		    print "pagesize: run failed: " run > "/dev/stderr"
+		    exit 1
+		}
+		printf "%s\t%d\t%d\t%d\t%.2f\t%d\t%.2f\t%d\t%.2f\n", run,
+		       entries, bytes, faults, 1000 * faults / user, misses,
+		       1000 * misses / user, user, end - start
+	    }'
+    done
+done
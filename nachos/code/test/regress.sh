@@ -0,0 +1,101 @@
+#!/bin/bash
+# regress.sh
+#	Check that the optimized build of nachos simulates exactly the
+#	same machine as the normal one.
+#
+#	A scratch copy of the tree is made, so that the objects here are
+#	left alone, and userprog/nachos is built there twice: once as
+#	usual, and once with "gmake optimized" (-O2 -flto).  Every user
+#	program in this directory is then run as a one-line batch job
+#	under both builds, with and without the block cache, and
+#	the output -- including the tick counts -- must match.
+#
+#	The vm build is then made in the same copy, and the programs in
+#	LOWMEM (matmult, by default) run under it with -mem 6, where
+#	nearly every page fault evicts a dirty page, and the page cleaner
+#	has the swap disk ahead of the faults.  They must exit with the
+#	same code as above, and Nachos must halt cleanly.
+#
+#	The shell is left out, since it waits for console input.
+#
+#	Usage, from the test directory:  ./regress.sh [program ...]
+#
+# Copyright (c) 1992-1993 The Regents of the University of California.
+# All rights reserved.  See copyright.h for copyright notice and limitation
+# of liability and disclaimer of warranty provisions.
+
+MAKE=${MAKE:-make}
+TIMEOUT=${TIMEOUT:-120}
+LOWMEM=${LOWMEM-matmult}
+
+CODE=$(cd "$(dirname "$0")/.." && pwd)
+SCRATCH=$(mktemp -d /tmp/nachos-regress.XXXXXX)
+trap 'rm -rf $SCRATCH' EXIT
+
+# build <name> <directory> <make target>
+build() {
+    [ -d $SCRATCH/$1 ] || cp -r "$CODE" $SCRATCH/$1
+    (cd $SCRATCH/$1/$2 && $MAKE clean > /dev/null &&
+	$MAKE -j$(nproc) $3 > $SCRATCH/$1.log 2>&1) || {
+	echo "regress: $1 $2 build failed, see below"
+	cat $SCRATCH/$1.log
+	exit 1
+    }
+}
+
+build plain userprog nachos
+build optimized userprog optimized
+
+if [ $# -gt 0 ]; then
+    programs="$*"
+else
+    programs=
+    for c in $CODE/test/*.c; do
+	p=$(basename $c .c)
+	[ -f $CODE/test/$p -a $p != shell ] && programs="$programs $p"
+    done
+fi
+
+# Nachos polls the console, so stdin has to stay open (and empty) until
+# the run is over; hence the sleep.
+# run <name> <program> <flags> [<directory>]
+run() {
+    (cd $SCRATCH/$1/test &&
+	timeout $TIMEOUT ../${4:-userprog}/nachos $3 -F $SCRATCH/$2.batch \
+	    < <(sleep $TIMEOUT 2> /dev/null) 2>&1)
+}
+
+failed=0
+for p in $programs; do
+    printf "2\n../test/$p\n" > $SCRATCH/$p.batch
+    for flags in "" "-bc 2"; do
+	run plain $p "$flags" > $SCRATCH/$p.plain
+	run optimized $p "$flags" > $SCRATCH/$p.optimized
+	if cmp -s $SCRATCH/$p.plain $SCRATCH/$p.optimized; then
+	    echo "ok      $p $flags   $(grep Ticks: $SCRATCH/$p.plain)"
+	else
+	    echo "FAILED  $p $flags"
+	    diff $SCRATCH/$p.plain $SCRATCH/$p.optimized | head -20
+	    failed=1
+	fi
+    done
+done
+
+build plain vm nachos
+for p in $LOWMEM; do
+    case " $programs " in *" $p "*) ;; *) continue ;; esac
+    run plain $p "-mem 6" vm > $SCRATCH/$p.lowmem
+    status=$?
+    if [ $status -eq 0 ] &&
+	    grep -q "^Ticks: total" $SCRATCH/$p.lowmem &&
+	    cmp -s <(grep "Exit called" $SCRATCH/$p.plain) \
+		   <(grep "Exit called" $SCRATCH/$p.lowmem); then
+	echo "ok      $p vm -mem 6   $(grep Swap: $SCRATCH/$p.lowmem)"
+    else
+	echo "FAILED  $p vm -mem 6 (exit status $status)"
+	tail -20 $SCRATCH/$p.lowmem
+	failed=1
+    fi
+done
+
+exit $failed
@@ -0,0 +1,168 @@
+#!/bin/bash
+# sweep.sh
+#	Run a matrix of Nachos experiments in parallel, one process per
+#	host core, and tabulate the statistics each run prints when it
+#	halts.
+#
+#	Every batch file is run under every scheduler type (the first
+#	line of the batch is replaced), every time slice (-q) and every
+#	random seed (-rs); a seed of "-" means no -rs.  For each batch,
+#	scheduler type and time slice, the table gives the mean and the
+#	variance over the seeds of:
+#
+#		ticks idle system user	the "Ticks:" line
+#		busy util		total CPU busy time, CPU utilisation
+#		burst wait		average CPU burst, average wait in
+#					the ready queue
+#		done maxdone		average and maximum thread
+#					completion time
+#
+#	The table is tab-separated, so it can be fed to a spreadsheet or
+#	to "column -t".  With -o, the numbers from each run are also
+#	written to <raw file>, one line per run.  Runs that fail or time
+#	out are reported, and left out of the table.
+#
+#	Usage, from the test directory, once userprog/nachos is built:
+#
+#	    ./sweep.sh [-j <jobs>] [-t "<types>"] [-q "<quanta>"]
+#		[-s "<seeds>"] [-x "<nachos flags>"] [-o <raw file>]
+#		<batch file> ...
+#
+#	The defaults are -j $(nproc) -t "0 1 2 3" -q 100 -s "-".  For
+#	instance,
+#
+#	    ./sweep.sh -q "50 100 200" -s "1 2 3 4 5" -x "-dc 64 2 16 lru" B4.txt
+#
+#	makes 60 runs of B4.txt.
+#
+# Copyright (c) 1992-1993 The Regents of the University of California.
+# All rights reserved.  See copyright.h for copyright notice and limitation
+# of liability and disclaimer of warranty provisions.
+
+TIMEOUT=${TIMEOUT:-120}
+
+CODE=$(cd "$(dirname "$0")/.." && pwd)
+NACHOS=$CODE/userprog/nachos
+METRICS="ticks idle system user busy util burst wait done maxdone"
+
+# One run, started by xargs below:  sweep.sh --run <batch> <type> <quantum>
+# <seed>.  Prints the batch, type, quantum and seed, then the metrics,
+# on one line (short enough to be written atomically, so the parallel
+# runs don't interleave).
+if [ "$1" = "--run" ]; then
+    batch=$2 type=$3 quantum=$4 seed=$5
+    tmp=$(mktemp /tmp/nachos-sweep.XXXXXX)
+    { echo $type; tail -n +2 $batch; } > $tmp
+    rs=
+    [ "$seed" != "-" ] && rs="-rs $seed"
+
+    # Nachos polls the console, so stdin has to stay open (and empty)
+    # until the run is over; hence the sleep.
+    out=$(cd $CODE/test && timeout $TIMEOUT $NACHOS $FLAGS $rs -q $quantum \
+	      -F $tmp < <(sleep $TIMEOUT 2> /dev/null) 2>&1)
+    rm -f $tmp
+    echo "$out" | awk -v run="$batch	$type	$quantum	$seed" '
+	/^Ticks: total/ { gsub(",", ""); ticks = $3; idle = $5;
+			  sys = $7; user = $9; halted = 1 }
+	/^Total CPU Busy Time/			{ busy = $NF }
+	/^CPU Utilisation/			{ util = $NF }
+	/^Average Burst/			{ burst = $NF }
+	/^Average Ready Queue Wait Time/	{ wait = $NF }
+	/^Average Thread Completion Time/	{ done = $NF }
+	/^Max Thread Completion Time/		{ maxdone = $NF }
+	END {
+	    if (!halted) {
+		print "sweep: run failed: " run > "/dev/stderr"
+		exit 1
+	    }
+	    print run "\t" ticks "\t" idle "\t" sys "\t" user "\t" \
+		  busy "\t" util "\t" burst "\t" wait "\t" done "\t" maxdone
+	}'
+    exit
+fi
+
+jobs=$(nproc)
+types="0 1 2 3"
+quanta=100
+seeds="-"
+FLAGS=
+raw=
+while getopts "j:t:q:s:x:o:" opt; do
+    case $opt in
+      j) jobs=$OPTARG ;;
+      t) types=$OPTARG ;;
+      q) quanta=$OPTARG ;;
+      s) seeds=$OPTARG ;;
+      x) FLAGS=$OPTARG ;;
+      o) raw=$OPTARG ;;
+      *) echo "usage: $0 [-j jobs] [-t types] [-q quanta] [-s seeds]" \
+	      "[-x flags] [-o raw file] batch ..." >&2
+	 exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+if [ $# -eq 0 ]; then
+    echo "sweep: no batch files given" >&2
+    exit 2
+fi
+if [ ! -x $NACHOS ]; then
+    echo "sweep: build $NACHOS first" >&2
+    exit 2
+fi
+export FLAGS TIMEOUT
+
+runs=$(mktemp /tmp/nachos-sweep.XXXXXX)
+trap 'rm -f $runs' EXIT
+
+for batch in "$@"; do
+    batch=$(cd "$(dirname "$batch")" && pwd)/$(basename "$batch")
+    for type in $types; do
+	for quantum in $quanta; do
+	    for seed in $seeds; do
+		echo "$batch $type $quantum $seed"
+	    done
+	done
+    done
+done | xargs -P $jobs -L 1 "$0" --run > $runs
+
+[ -n "$raw" ] && sort -t "	" -k1,1 -k2n -k3n -k4 $runs > "$raw"
+
+# Group the runs by batch, type and quantum, and print the mean and
+# (sample) variance of each metric over the seeds.
+sort -t "	" -k1,1 -k2n -k3n $runs | awk -F "\t" -v metrics="$METRICS" '
+    BEGIN {
+	m = split(metrics, name, " ")
+	printf "batch\ttype\tquantum\truns"
+	for (i = 1; i <= m; i++)
+	    printf "\t%s\t%s.var", name[i], name[i]
+	printf "\n"
+    }
+    function flush() {
+	if (n == 0)
+	    return
+	printf "%s\t%d", key, n
+	for (i = 1; i <= m; i++) {
+	    mean = sum[i] / n
+	    var = (n > 1) ? (sumsq[i] - n * mean * mean) / (n - 1) : 0
+	    if (var < 0)		# rounding
+		var = 0
+	    printf "\t%.1f\t%.1f", mean, var
+	}
+	printf "\n"
+    }
+    {
+	k = $1 "\t" $2 "\t" $3
+	if (k != key) {
+	    flush()
+	    key = k
+	    n = 0
+	    for (i = 1; i <= m; i++)
+		sum[i] = sumsq[i] = 0
+	}
+	n++
+	for (i = 1; i <= m; i++) {
+	    sum[i] += $(i + 4)
+	    sumsq[i] += $(i + 4) * $(i + 4)
+	}
+    }
+    END { flush() }'
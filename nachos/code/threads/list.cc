@@ -142,7 +142,7 @@ List::Mapcar(VoidFunctionPtr func)
 {
     for (ListElement *ptr = first; ptr != NULL; ptr = ptr->next) {
        DEBUG('l', "In mapcar, about to invoke %x(%x)\n", func, ptr->item);
-       (*func)((int)ptr->item);
+       (*func)((intptr_t)ptr->item);
     }
 }
 
@@ -164,7 +164,10 @@ List::Unix()
     ListElement *cur=NULL,*pre=NULL,*prev = NULL;
     for (ListElement *ptr = first; ptr != NULL; ptr = ptr->next) {
        temp = (NachOSThread *) ptr->item;
-       if(temp->GetPriority() < p){
+       // The first one is a candidate whatever its priority: a thread
+       // that keeps blocking on I/O isn't decayed while it waits, and
+       // can run up a priority of more than p starts at.
+       if(cur == NULL || temp->GetPriority() < p){
             curr = temp;
             cur = ptr;
             pre = prev;
@@ -308,3 +311,28 @@ List::SortedRemove(int *keyPtr)
     return thing;
 }
 
+//----------------------------------------------------------------------
+// List::SortedPeek
+//      Return the first "item" of a sorted list, leaving it in place.
+// 
+// Returns:
+//	Pointer to the first item, NULL if nothing on the list.
+//	Sets *keyPtr to the priority value of that item, and *tiedPtr
+//	to TRUE if the item after it has the same priority.
+//
+//	"keyPtr", "tiedPtr" -- where to store the results, if not NULL
+//----------------------------------------------------------------------
+
+void *
+List::SortedPeek(int *keyPtr, bool *tiedPtr)
+{
+    if (IsEmpty()) 
+	return NULL;
+
+    if (keyPtr != NULL)
+        *keyPtr = first->key;
+    if (tiedPtr != NULL)
+	*tiedPtr = (first->next != NULL) && (first->next->key == first->key);
+    return first->item;
+}
+
@@ -8,8 +8,18 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//	The nachos program just calls RunNachos (see nachos.cc); other
+//	programs can call it too, to run simulations of their own.
+//
+// Usage: nachos -d <debugflags> -rs <random seed #> -q <quantum>
+//		-record <replay log> -replay <replay log> -trace <trace file>
+//		-s -bc <threshold> -prof <interval> -x <nachos file>
+//		-ic <rows> <assoc> <line size> <lru|random>
+//		-dc <rows> <assoc> <line size> <lru|random> -cost <cost file>
+//		-ckpt <checkpoint file> <ticks> -restore <checkpoint file>
+//		-ps <page size> -mem <frames>
+//		-pr <fifo|random|clock|aging> -tlb <entries> <assoc>
+//		-c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
@@ -18,13 +28,49 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -q sets the time slice of scheduler types 1 and 2, in ticks
+//	(TimerTicks by default); it is checked at each timer interrupt
+//    -record logs every interrupt, timer interval and input character
+//	or packet in <replay log>; -replay plays the log back, so that
+//	the run repeats exactly (see machine/replay.h)
+//    -trace keeps a cheap trace of context switches, the ready list,
+//	system calls, interrupts and disk requests, and writes it to
+//	<trace file> for chrome://tracing or Perfetto (see threads/trace.h)
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bc keeps blocks of user code pre-decoded in a cache once they
+//	have been entered <threshold> times, to speed up long-running
+//	programs (see machine/blockcache.h).  It is ignored with -s,
+//	-ic, -dc, -cost, -prof, -ckpt, or the m, a or i debug flags,
+//	which need the interpreter to stop at each instruction; Nachos
+//	then charges and counts instructions one at a time, and runs at
+//	the interpreter's speed
+//    -prof samples the PC of user programs every <interval> ticks
+//	(every instruction if 0), and prints where they spent their
+//	time when Nachos halts
+//    -ic, -dc model an instruction or data cache with <rows> sets of
+//	<assoc> lines of <line size> bytes; each miss costs extra time
+//    -cost charges each user instruction by its kind, using the
+//	cycle counts in <cost file> (see machine/costmodel.h)
+//    -ckpt saves the state of the simulation in <checkpoint file>, as
+//	soon as it can after <ticks>, and carries on (see checkpoint.h)
+//    -restore starts from a checkpoint, instead of loading programs
+//    -ps sets the page size, in bytes: a power of 2, at least 16 (by
+//	default, the disk sector size); -mem sets the number of frames
+//	of physical memory (512 by default; at least 3 in the vm build)
 //    -x runs a user program
 //    -c tests the console
 //
+//  VM
+//    -pr chooses the page replacement policy (clock by default; see
+//	vm/frametable.h)
+//    -tlb gives the TLB <entries> entries, in sets of <assoc>, which
+//	must be at least 2 and divide <entries> (4 and 4 by default);
+//	it is only used when USE_TLB is defined, as it is in the vm
+//	build
+//
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
@@ -54,6 +100,7 @@
 #include "machine.h"
 #include "syscall.h"
 #include "stats.h"
+#include "nachos.h"
 #include <fstream>
 #include <stdio.h>
 #include <string>
@@ -72,25 +119,89 @@ extern int system_call_Fork(void);
 extern void BulkAdd(char *filename,int p);
 
 //----------------------------------------------------------------------
-// main
-// 	Bootstrap the operating system kernel.  
+// FreeThreads
+// 	Delete the threads that were still around when the simulation
+//	halted, and their stacks.  Called once we are back on the host
+//	thread's own stack, so even the thread that halted can go.
+//	Threads that exited have already been deleted, apart from the
+//	one that may have been left in threadToBeDestroyed.  The vm
+//	build's page cleaner never exits, and is deleted on its own: an
+//	exited thread's slot in threadArray may point at the memory it
+//	was given.
+//----------------------------------------------------------------------
+
+static void
+FreeThreads()
+{
+    NachOSThread *halted = currentThread;
+    NachOSThread *thread;
+
+    currentThread = NULL;
+    for (unsigned i = 0; i < thread_index; i++) {
+	thread = threadArray[i];
+#ifdef VM
+	if (thread == pageCleaner)
+	    continue;
+#endif
+	if ((thread != NULL) && (!exitThreadArray[i] || (thread == halted)
+				 || (thread == threadToBeDestroyed)))
+	    delete thread;
+    }
+    threadToBeDestroyed = NULL;
+#ifdef VM
+    if (pageCleaner != NULL) {
+	delete pageCleaner;
+	pageCleaner = NULL;
+    }
+#endif
+}
+
+//----------------------------------------------------------------------
+// RunNachos
+// 	Bootstrap the operating system kernel, and run it until it halts.
 //	
 //	Check command line arguments
 //	Initialize data structures
 //	(optionally) Call test procedure
 //
+//	When the simulation halts, Cleanup jumps back here, and we return
+//	to the caller, with the statistics in "result".
+//
 //	"argc" is the number of command line arguments (including the name
 //		of the command) -- ex: "nachos -d +" -> argc = 3 
 //	"argv" is an array of strings, one for each command line argument
 //		ex: "nachos -d +" -> argv = {"nachos", "-d", "+"}
+//	"result" -- where to copy the final statistics, or NULL
 //----------------------------------------------------------------------
 
 int
-main(int argc, char **argv)
+RunNachos(int argc, char **argv, Statistics *result)
 {
 
     int argCount;			// the number of arguments 
 					// for a particular command
+    jmp_buf halted;			// where Cleanup comes back to
+
+    if (setjmp(halted) != 0) {
+	haltPoint = NULL;
+	FreeThreads();
+#ifdef USER_PROGRAM
+	delete frameMap;		// after the threads' address spaces
+#ifdef VM				// have given their frames back
+	delete [] frameReferences;
+	delete frameTable;
+	delete swapSpace;		// after the backing stores
+#endif
+#ifdef INVERTED_PAGE_TABLE
+	delete invertedPageTable;
+#endif
+#endif
+	if (result != NULL)
+	    *result = *stats;
+	delete stats;
+	return 0;
+    }
+    haltPoint = &halted;
 
     DEBUG('t', "Entering main");
     (void) Initialize(argc, argv);
@@ -109,6 +220,10 @@ main(int argc, char **argv)
             StartUserProcess(*(argv + 1));
             DEBUG('k', "exec.\n");
 
+            argCount = 2;
+        } else if (!strcmp(*argv, "-restore")) {  // resume a checkpoint
+	    ASSERT(argc > 1);
+            RestoreCheckpoint(*(argv + 1));
             argCount = 2;
         } else if (!strcmp(*argv, "-c")) {      // test the console
 	    if (argc == 1)
@@ -0,0 +1,20 @@
+// nachos.cc
+//	The nachos program: run the one simulation described by the
+//	command line.  Everything else is in the library (see nachos.h).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "nachos.h"
+#include "system.h"
+
+int
+main(int argc, char **argv)
+{
+    // Only here: a program running several simulations has no one
+    // simulation for ctl-C to clean up.
+    CallOnUserAbort(Cleanup);			// if user hits ctl-C
+    return RunNachos(argc, argv, NULL);
+}
@@ -0,0 +1,35 @@
+// nachos.h
+//	Running Nachos from another program.
+//
+//	RunNachos takes the same arguments as the nachos command (see
+//	main.cc), runs the simulation they describe, and returns once the
+//	simulated machine halts.  If "result" isn't NULL, the statistics
+//	the simulation kept (see machine/stats.h) are copied into it, so
+//	the caller can use them without reading what was printed.
+//
+//	Everything a simulation uses is private to the host thread that
+//	runs it (see system.h), so a program can run many simulations at
+//	once, each in a thread of its own (with pthread_create, say), or
+//	one after another in the same thread.  They all share the host's
+//	standard input and output, which is where the consoles and the
+//	statistics go; and an ASSERT that fails in one of them still aborts
+//	the whole program.  RunNachos doesn't catch ctl-C: the nachos
+//	program arranges for it to halt its one simulation, but no handler
+//	is installed otherwise, so it just stops the program.
+//
+//	"gmake libnachos.a", in any of the directories nachos is built in,
+//	packages everything but main() into a library to link with.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef NACHOS_H
+#define NACHOS_H
+
+#include "stats.h"
+
+extern int RunNachos(int argc, char **argv, Statistics *result);
+						// run one simulation
+
+#endif // NACHOS_H
@@ -148,6 +148,8 @@ NachOSscheduler::Schedule (NachOSThread *nextThread)
     
     DEBUG('t', "Switching from thread \"%s\" with pid %d to thread \"%s\" with pid %d\n",
 	  oldThread->getName(), oldThread->GetPID(), nextThread->getName(), nextThread->GetPID());
+    if (eventTrace != NULL)
+	eventTrace->Record(TraceSwitch, nextThread->GetPID(), oldThread->GetPID());
     
     // This is a machine-dependent assembly language routine defined 
     // in switch.s.  You may have to think
@@ -228,4 +230,49 @@ NachOSscheduler::UNIX_priority_set(int burst)
   }
   if(!readyThreadList->IsEmpty())readyThreadList->Mapcar((VoidFunctionPtr) SetP);
   
-}
\ No newline at end of file
+}
+//----------------------------------------------------------------------
+// NachOSscheduler::Checkpoint
+//	Save the ready list, as the pids of the threads on it in order,
+//	in the checkpoint file "fd".
+//----------------------------------------------------------------------
+
+static thread_local int checkpointFd;	// where SavePID writes
+
+static void
+SavePID(intptr_t arg)
+{
+    int pid = ((NachOSThread *)arg)->GetPID();
+
+    WriteFile(checkpointFd, (char *)&pid, sizeof(int));
+}
+
+void
+NachOSscheduler::Checkpoint(int fd)
+{
+    int count = readyThreadList->NumOfElements();
+
+    WriteFile(fd, (char *)&count, sizeof(int));
+    checkpointFd = fd;
+    readyThreadList->Mapcar(SavePID);
+}
+
+//----------------------------------------------------------------------
+// NachOSscheduler::Restore
+//	Rebuild the ready list saved by Checkpoint.  The threads must
+//	already have been restored, and their saved ready queue times
+//	are kept as they were.
+//----------------------------------------------------------------------
+
+void
+NachOSscheduler::Restore(int fd)
+{
+    int count, pid;
+
+    Read(fd, (char *)&count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+        Read(fd, (char *)&pid, sizeof(int));
+        ASSERT(threadArray[pid] != NULL);
+        readyThreadList->Append((void *)threadArray[pid]);
+    }
+}
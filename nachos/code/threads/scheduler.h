@@ -31,6 +31,8 @@ class NachOSscheduler {
     
     void Tail();                        // Used by fork()
     void UNIX_priority_set(int burst);		// Implemented for UNIX scheduling
+    void Checkpoint(int fd);		// Save the ready list in a checkpoint
+    void Restore(int fd);		// and read it back
   private:
     List *readyThreadList;  		// queue of threads that are ready to run,
 				// but not running
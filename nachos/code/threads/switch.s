@@ -10,6 +10,7 @@
  *	    SUN SPARC
  *	    HP PA-RISC
  *	    Intel 386
+ *	    Intel x86-64 (AMD64)
  *
  * We define two routines for each architecture:
  *
@@ -339,3 +340,74 @@ _SWITCH:
         ret
 
 #endif
+
+#ifdef HOST_x86_64
+
+        .text
+        .align  16
+
+        .globl  _ThreadRoot
+
+/* void ThreadRoot( void )
+**
+** expects the following registers to be initialized:
+**      r15     points to startup function (interrupt enable)
+**      r13     contains inital argument to thread function
+**      r12     points to thread function
+**      r14     point to Thread::FinishThread()
+**
+** All four are callee-saved, so they survive the calls below.
+** We arrive here via the "ret" in SWITCH, so the stack must be
+** re-aligned to 16 bytes before calling into C++ code.
+*/
+_ThreadRoot:
+        pushq   %rbp
+        movq    %rsp,%rbp
+        andq    $-16,%rsp
+        call    *StartupPC
+        movq    InitialArg,%rdi
+        call    *InitialPC
+        call    *WhenDonePC
+
+        # NOT REACHED
+        movq    %rbp,%rsp
+        popq    %rbp
+        ret
+
+
+
+/* void SWITCH( thread *t1, thread *t2 )
+**
+** on entry, t1 is in rdi, t2 is in rsi, and (rsp) holds the
+** return address.  Only callee-saved registers need to be kept;
+** the caller has already spilled everything else.
+*/
+        .globl  _SWITCH
+_SWITCH:
+        movq    %rsp,_RSP(%rdi)         # save stack pointer
+        movq    %rbx,_RBX(%rdi)         # save registers
+        movq    %rbp,_RBP(%rdi)
+        movq    %r12,_R12(%rdi)
+        movq    %r13,_R13(%rdi)
+        movq    %r14,_R14(%rdi)
+        movq    %r15,_R15(%rdi)
+        movq    0(%rsp),%rax            # get return address from stack
+        movq    %rax,_PC(%rdi)          # save it into the pc storage
+
+        movq    _RBX(%rsi),%rbx         # restore old registers
+        movq    _RBP(%rsi),%rbp
+        movq    _R12(%rsi),%r12
+        movq    _R13(%rsi),%r13
+        movq    _R14(%rsi),%r14
+        movq    _R15(%rsi),%r15
+        movq    _RSP(%rsi),%rsp         # restore stack pointer
+        movq    _PC(%rsi),%rax          # restore return address
+        movq    %rax,0(%rsp)            # copy over the ret address on the stack
+
+        ret
+
+        # none of this needs an executable stack; without the note, the
+        # linker assumes it does
+        .section .note.GNU-stack,"",@progbits
+
+#endif
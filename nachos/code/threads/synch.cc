@@ -97,14 +97,165 @@ Semaphore::V()
     (void) interrupt->SetLevel(oldLevel);
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// Semaphore::Checkpoint
+// 	Save the value of the semaphore, and the pids of the threads
+//	waiting in P(), in order, in the checkpoint file "fd".
+//----------------------------------------------------------------------
+
+static thread_local int checkpointFd;	// where SaveWaiter writes
+
+static void
+SaveWaiter(intptr_t arg)
+{
+    int pid = ((NachOSThread *)arg)->GetPID();
+
+    WriteFile(checkpointFd, (char *)&pid, sizeof(int));
+}
+
+void
+Semaphore::Checkpoint(int fd)
+{
+    int count = queue->NumOfElements();
+
+    WriteFile(fd, (char *)&value, sizeof(int));
+    WriteFile(fd, (char *)&count, sizeof(int));
+    checkpointFd = fd;
+    queue->Mapcar(SaveWaiter);
+}
+
+//----------------------------------------------------------------------
+// Semaphore::Restore
+// 	Put back what Checkpoint saved.  The waiting threads must already
+//	have been restored.
+//----------------------------------------------------------------------
+
+void
+Semaphore::Restore(int fd)
+{
+    int count, pid;
+
+    Read(fd, (char *)&value, sizeof(int));
+    Read(fd, (char *)&count, sizeof(int));
+    for (int i = 0; i < count; i++) {
+	Read(fd, (char *)&pid, sizeof(int));
+	ASSERT(threadArray[pid] != NULL);
+	queue->Append((void *)threadArray[pid]);
+    }
+}
+#endif
+
+//----------------------------------------------------------------------
+// Lock::Lock
+// 	Initialize a lock, FREE, with no preferred thread.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Lock::Lock(char* debugName)
+{
+    name = debugName;
+    holder = NULL;
+    queue = new List;
+    preferred = NULL;
+    preferredWaiting = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Lock::~Lock
+// 	De-allocate the lock.  Assume no one holds it, or is waiting
+//	for it!
+//----------------------------------------------------------------------
+
+Lock::~Lock()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Lock::Acquire, Release
+// 	Wait until the lock is FREE, and take it; or give it back.  Only
+//	the thread that acquired the lock may release it.
+//
+//	Like Semaphore::P and V: Release wakes up the first waiter, which
+//	takes the lock if it is still FREE when it runs, and otherwise
+//	waits again.  The preferred thread, though, waits apart from the
+//	others, and if it is waiting, Release makes it the holder before
+//	waking it up.
+//
+//	As with semaphores, interrupts are disabled to make these atomic.
+//----------------------------------------------------------------------
+
+void
+Lock::Acquire()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if ((holder != NULL) && (currentThread == preferred)) {
+	preferredWaiting = TRUE;
+	currentThread->PutThreadToSleep();	// Release() wakes us up
+	ASSERT(isHeldByCurrentThread());	// holding the lock
+    } else {
+	while (holder != NULL) { 			// lock not available
+	    queue->Append((void *)currentThread);	// so go to sleep
+	    currentThread->PutThreadToSleep();
+	}
+	holder = currentThread;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+void
+Lock::Release()
+{
+    NachOSThread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(isHeldByCurrentThread());
+    if (preferredWaiting) {
+	preferredWaiting = FALSE;
+	holder = preferred;
+	scheduler->ThreadIsReadyToRun(preferred);
+    } else {
+	holder = NULL;
+	thread = (NachOSThread *)queue->Remove();
+	if (thread != NULL)
+	    scheduler->ThreadIsReadyToRun(thread);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::Prefer
+// 	Hand the lock straight to "thread", rather than to whoever wins
+//	the race for it, whenever "thread" is waiting for it when it is
+//	released.
+//
+//	"thread" -- the thread to prefer; it mustn't be waiting already
+//----------------------------------------------------------------------
+
+void
+Lock::Prefer(NachOSThread *thread)
+{
+    ASSERT(!preferredWaiting);
+    preferred = thread;
+}
+
+//----------------------------------------------------------------------
+// Lock::isHeldByCurrentThread
+// 	Return TRUE if the current thread has acquired the lock.
+//----------------------------------------------------------------------
+
+bool
+Lock::isHeldByCurrentThread()
+{
+    return holder == currentThread;
+}
+
 // Dummy functions -- so we can compile our later assignments 
 // Note -- without a correct implementation of Condition::Wait(), 
 // the test case in the network assignment won't work!
-Lock::Lock(char* debugName) {}
-Lock::~Lock() {}
-void Lock::Acquire() {}
-void Lock::Release() {}
-
 Condition::Condition(char* debugName) { }
 Condition::~Condition() { }
 void Condition::Wait(Lock* conditionLock) { ASSERT(FALSE); }
@@ -3,9 +3,9 @@
 //
 //	Three kinds of synchronization are defined here: semaphores,
 //	locks, and condition variables.  The implementation for
-//	semaphores is given; for the latter two, only the procedure
-//	interface is given -- they are to be implemented as part of 
-//	the first assignment.
+//	semaphores and locks is given; for condition variables, only
+//	the procedure interface is given -- they are to be implemented
+//	as part of the first assignment.
 //
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
@@ -44,6 +44,11 @@ class Semaphore {
     
     void P();	 // these are the only operations on a semaphore
     void V();	 // they are both *atomic*
+
+#ifdef USER_PROGRAM
+    void Checkpoint(int fd);	// save the value and the waiting threads
+    void Restore(int fd);	// ... and put them back
+#endif
     
   private:
     char* name;        // useful for debugging
@@ -62,6 +67,11 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// One thread may be preferred: if it is waiting when the lock is
+// released, the lock is handed straight to it.  Otherwise a thread
+// that releases the lock and soon wants it back would usually get it
+// first, since the waiter it woke up hasn't run yet.
 
 class Lock {
   public:
@@ -72,6 +82,9 @@ class Lock {
     void Acquire(); // these are the only operations on a lock
     void Release(); // they are both *atomic*
 
+    void Prefer(NachOSThread *thread);	// hand the lock to "thread"
+					// first, when it is waiting
+
     bool isHeldByCurrentThread();	// true if the current thread
 					// holds this lock.  Useful for
 					// checking in Release, and in
@@ -79,7 +92,10 @@ class Lock {
 
   private:
     char* name;				// for debugging
-    // plus some other stuff you'll need to define
+    NachOSThread *holder;		// who has acquired it, if anyone
+    List *queue;			// threads waiting in Acquire()
+    NachOSThread *preferred;		// see Prefer(), or NULL
+    bool preferredWaiting;		// is it waiting in Acquire()?
 };
 
 // The following class defines a "condition variable".  A condition
@@ -7,52 +7,85 @@
 
 #include "copyright.h"
 #include "system.h"
+#ifdef USER_PROGRAM
+#include "cache.h"
+#include "costmodel.h"
+#endif
 
 // This defines *all* of the global data structures used by Nachos.
-// These are all initialized and de-allocated by this file.
-
-NachOSThread *currentThread;			// the thread we are running now
-NachOSThread *threadToBeDestroyed;  		// the thread that just finished
-NachOSscheduler *scheduler;			// the ready list
-Interrupt *interrupt;			// interrupt status
-Statistics *stats;			// performance metrics
-Timer *timer;				// the hardware timer device,
+// These are all initialized and de-allocated by this file.  Each host
+// thread running a simulation has its own set.
+
+thread_local NachOSThread *currentThread;			// the thread we are running now
+thread_local NachOSThread *threadToBeDestroyed;  		// the thread that just finished
+thread_local NachOSscheduler *scheduler;			// the ready list
+thread_local Interrupt *interrupt;			// interrupt status
+thread_local Statistics *stats;			// performance metrics
+thread_local Timer *timer;				// the hardware timer device,
 					// for invoking context switches
-unsigned numPagesAllocated;              // number of physical frames allocated
-int scheduler_type;
-int process_start_time;
-NachOSThread *threadArray[MAX_THREAD_COUNT];  // Array of thread pointers
-unsigned thread_index;                  // Index into this array (also used to assign unique pid)
-bool initializedConsoleSemaphores;
-bool exitThreadArray[MAX_THREAD_COUNT];  //Marks exited threads
+thread_local ReplayLog *replayLog;		// NULL unless -record or -replay
+					// was given
+thread_local EventTrace *eventTrace;		// NULL unless -trace was given
+thread_local unsigned numPagesAllocated;              // number of physical frames in use
+thread_local int scheduler_type;
+thread_local int quantum;				// time slice, set by -q
+thread_local int process_start_time;
+thread_local NachOSThread *threadArray[MAX_THREAD_COUNT];  // Array of thread pointers
+thread_local unsigned thread_index;                  // Index into this array (also used to assign unique pid)
+thread_local bool initializedConsoleSemaphores;
+thread_local bool exitThreadArray[MAX_THREAD_COUNT];  //Marks exited threads
 
 // STATS 
-int total_burst;
-int total_max_burst;
-int total_min_burst;
-int total_burst_count;
-int system_start_time;
-int total_ready_queue_waittime;
-int total_thread_time;
-int total_max_thread_time;
-int total_min_thread_time;
-int thread_count;
-TimeSortedWaitQueue *sleepQueueHead;    // Needed to implement SC_Sleep
+thread_local int total_burst;
+thread_local int total_max_burst;
+thread_local int total_min_burst;
+thread_local int total_burst_count;
+thread_local int system_start_time;
+thread_local int total_ready_queue_waittime;
+thread_local int total_thread_time;
+thread_local int total_max_thread_time;
+thread_local int total_min_thread_time;
+thread_local int thread_count;
+thread_local TimeSortedWaitQueue *sleepQueueHead;    // Needed to implement SC_Sleep
+thread_local jmp_buf *haltPoint;	// in RunNachos, or NULL
 
 #ifdef FILESYS_NEEDED
-FileSystem  *fileSystem;
+thread_local FileSystem  *fileSystem;
 #endif
 
 #ifdef FILESYS
-SynchDisk   *synchDisk;
+thread_local SynchDisk   *synchDisk;
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
-Machine *machine;	// user program memory and registers
+thread_local Machine *machine;	// user program memory and registers
+thread_local int pageSize;		// set by -ps, and the number of
+thread_local int numPhysPages;		// frames by -mem
+thread_local Profiler *profiler;	// NULL unless -prof was given
+thread_local char *checkpointFile;	// NULL unless -ckpt was given,
+thread_local int checkpointTime;	// or once the checkpoint has been taken
+thread_local BitMap *frameMap;		// frames are given back when an
+					// address space is deleted
+#ifdef VM
+thread_local int *frameReferences;	// a frame shared after a fork is
+					// copied when it is written to
+thread_local FrameTable *frameTable;	// pages are replaced with the
+					// policy given by -pr
+thread_local NachOSThread *pageCleaner;	// NULL until the first eviction
+thread_local SwapSpace *swapSpace;	// on a disk of its own
+#endif
+#ifdef USE_TLB
+thread_local int nextASID;		// never reused, so an address space
+					// that has gone needn't flush the TLB
+#endif
+#ifdef INVERTED_PAGE_TABLE
+thread_local InvertedPageTable *invertedPageTable;	// instead of a page
+					// table for each address space
+#endif
 #endif
 
 #ifdef NETWORK
-PostOffice *postOffice;
+thread_local PostOffice *postOffice;
 #endif
 
 // External definition, to allow us to take a pointer to this function
@@ -77,7 +110,7 @@ extern void Cleanup();
 //		whether it needs it or not.
 //----------------------------------------------------------------------
 static void
-TimerInterruptHandler(int dummy)
+TimerInterruptHandler(intptr_t dummy)
 {
     TimeSortedWaitQueue *ptr;
     if (interrupt->getStatus() != IdleMode) {
@@ -90,20 +123,38 @@ TimerInterruptHandler(int dummy)
         }
         if(scheduler_type == 1 ){
             int cpu_burst_current_thread =  stats->totalTicks - process_start_time ;
-            if (cpu_burst_current_thread >= TimerTicks) interrupt->YieldOnReturn();
+            if (cpu_burst_current_thread >= quantum) interrupt->YieldOnReturn();
         }
         else if(scheduler_type == 0 ){
 
         }
         else if(scheduler_type == 2){
             int cpu_burst_current_thread =  stats->totalTicks - process_start_time ;
-            if (cpu_burst_current_thread >= TimerTicks) interrupt->YieldOnReturn();
+            if (cpu_burst_current_thread >= quantum) interrupt->YieldOnReturn();
         }
         else if (scheduler_type == 3){
 
         }
     }
+#ifdef VM
+    frameTable->Age();
+#endif
+}
+
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// ParseCache
+// 	Build a cache model from the four arguments following -ic or -dc:
+//	<rows> <associativity> <line size> <lru|random>
+//----------------------------------------------------------------------
+
+static Cache *
+ParseCache(char *name, char **args)
+{
+    return new Cache(name, atoi(args[0]), atoi(args[1]), atoi(args[2]),
+		     !strcmp(args[3], "random"));
 }
+#endif
 
 //----------------------------------------------------------------------
 // Initialize
@@ -135,11 +186,30 @@ Initialize(int argc, char **argv)
     total_min_thread_time = 100000000;
     for (i=0; i<MAX_THREAD_COUNT; i++) { threadArray[i] = NULL; exitThreadArray[i] = false; }
     thread_index = 0;
+    scheduler_type = 0;
+    quantum = TimerTicks;
+    thread_count = 0;
 
     sleepQueueHead = NULL;
+    char *replayFile = NULL;	// the replay log, if any
+    bool replay = FALSE;	// and whether to replay or record it
+    char *traceFile = NULL;	// where to write the event trace, if any
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    int cacheThreshold = 0;	// cache blocks entered this often
+				// (0 means don't cache them)
+    int profileInterval = -1;	// ticks between profile samples
+				// (0 means every instruction, -1 none)
+    Cache *icache = NULL;	// instruction and data caches, if
+    Cache *dcache = NULL;	// we're modelling them
+    CostModel *costs = NULL;	// time taken by each kind of instruction,
+				// if they don't all take UserTick
+    int tlbEntries = TLBSize;	// size of the TLB, if there is one (see
+    int tlbWays = TLBSize;	// USE_TLB), and of its sets
+#endif
+#ifdef VM
+    ReplacementPolicy policy = ClockReplacement;	// see frametable.h
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
@@ -148,6 +218,13 @@ Initialize(int argc, char **argv)
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
 #endif
+
+#ifdef USER_PROGRAM
+    checkpointFile = NULL;
+    checkpointTime = 0;
+    pageSize = DefaultPageSize;
+    numPhysPages = DefaultNumPhysPages;
+#endif
     
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
 	argCount = 1;
@@ -158,16 +235,85 @@ Initialize(int argc, char **argv)
 	    	debugArgs = *(argv + 1);
 	    	argCount = 2;
 	    }
+	} else if (!strcmp(*argv, "-q")) {
+	    ASSERT(argc > 1);
+	    quantum = atoi(*(argv + 1));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-rs")) {
 	    ASSERT(argc > 1);
 	    RandomInit(atoi(*(argv + 1)));	// initialize pseudo-random
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-record") || !strcmp(*argv, "-replay")) {
+	    ASSERT(argc > 1);
+	    replayFile = *(argv + 1);
+	    replay = !strcmp(*argv, "-replay");
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-trace")) {
+	    ASSERT(argc > 1);
+	    traceFile = *(argv + 1);
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-bc")) {
+	    ASSERT(argc > 1);
+	    cacheThreshold = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-prof")) {
+	    ASSERT(argc > 1);
+	    profileInterval = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ic")) {
+	    ASSERT(argc > 4);
+	    icache = ParseCache("I-cache", argv + 1);
+	    argCount = 5;
+	} else if (!strcmp(*argv, "-dc")) {
+	    ASSERT(argc > 4);
+	    dcache = ParseCache("D-cache", argv + 1);
+	    argCount = 5;
+	} else if (!strcmp(*argv, "-cost")) {
+	    ASSERT(argc > 1);
+	    costs = new CostModel(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ckpt")) {
+	    ASSERT(argc > 2);
+	    checkpointFile = *(argv + 1);
+	    checkpointTime = atoi(*(argv + 2));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-tlb")) {
+	    ASSERT(argc > 2);
+	    tlbEntries = atoi(*(argv + 1));
+	    tlbWays = atoi(*(argv + 2));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-ps")) {
+	    ASSERT(argc > 1);
+	    pageSize = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-mem")) {
+	    ASSERT(argc > 1);
+	    numPhysPages = atoi(*(argv + 1));
+	    argCount = 2;
+	}
+#endif
+#ifdef VM
+	if (!strcmp(*argv, "-pr")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		policy = FIFOReplacement;
+	    else if (!strcmp(*(argv + 1), "random"))
+		policy = RandomReplacement;
+	    else if (!strcmp(*(argv + 1), "clock"))
+		policy = ClockReplacement;
+	    else if (!strcmp(*(argv + 1), "aging"))
+		policy = AgingReplacement;
+	    else
+		printf("Unknown replacement policy %s; using clock\n",
+		       *(argv + 1));
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -188,6 +334,12 @@ Initialize(int argc, char **argv)
 
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+    replayLog = NULL;				// the timer needs this
+    if (replayFile != NULL)
+	replayLog = new ReplayLog(replayFile, replay);
+    eventTrace = NULL;
+    if (traceFile != NULL)
+	eventTrace = new EventTrace(traceFile);
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new NachOSscheduler();		// initialize the ready queue
     //if (randomYield)				// start the timer (if needed)
@@ -202,10 +354,60 @@ Initialize(int argc, char **argv)
     currentThread->setStatus(RUNNING);
 
     interrupt->Enable();
-    CallOnUserAbort(Cleanup);			// if user hits ctl-C
     
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg);	// this must come first
+    // Cached blocks run without going through Machine::Run, where
+    // the profiler takes its samples, so profiling turns them off.
+    profiler = NULL;
+    if (profileInterval >= 0) {
+	profiler = new Profiler(profileInterval);
+	cacheThreshold = 0;
+    }
+
+    // A checkpoint is taken between two instructions in Machine::Run,
+    // which a cached block doesn't stop at; and it can't save the
+    // state of the random number generator behind -rs.
+    if (checkpointFile != NULL)
+	cacheThreshold = 0;
+    if (randomYield && (checkpointFile != NULL)) {
+	printf("Can't take a checkpoint with -rs; ignoring -ckpt\n");
+	checkpointFile = NULL;
+    }
+#ifdef VM
+    if (checkpointFile != NULL) {	// see checkpoint.h
+	printf("Can't take a checkpoint in the vm build; ignoring -ckpt\n");
+	checkpointFile = NULL;
+    }
+#endif
+    // A page must hold whole instructions, and the top of the stack
+    // (see ProcessAddrSpace::InitUserCPURegisters).
+    ASSERT((pageSize >= 16) && ((pageSize & (pageSize - 1)) == 0));
+#ifdef VM
+    // A load or store needs the data's page in memory along with the
+    // instruction's, and with only two frames the fault for one evicts
+    // the other, for ever.
+    ASSERT(numPhysPages >= 3);
+#else
+    ASSERT(numPhysPages > 0);
+#endif
+    machine = new Machine(debugUserProg, cacheThreshold, tlbEntries,
+			  tlbWays, icache, dcache, costs);
+						// this must come first
+    frameMap = new BitMap(NumPhysPages);
+#ifdef VM
+    frameReferences = new int[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+	frameReferences[i] = 0;
+    frameTable = new FrameTable(policy);
+    pageCleaner = NULL;
+    swapSpace = new SwapSpace();
+#endif
+#ifdef USE_TLB
+    nextASID = 0;
+#endif
+#ifdef INVERTED_PAGE_TABLE
+    invertedPageTable = new InvertedPageTable(NumPhysPages);
+#endif
 #endif
 
 #ifdef FILESYS
@@ -223,7 +425,9 @@ Initialize(int argc, char **argv)
 
 //----------------------------------------------------------------------
 // Cleanup
-// 	Nachos is halting.  De-allocate global data structures.
+// 	Nachos is halting.  De-allocate global data structures, and
+//	return from RunNachos; the nachos program then exits, but a
+//	program running several simulations carries on with the others.
 //----------------------------------------------------------------------
 void
 Cleanup()
@@ -234,6 +438,10 @@ Cleanup()
 #endif
     
 #ifdef USER_PROGRAM
+    if (profiler != NULL) {
+	profiler->Print();
+	delete profiler;
+    }
     delete machine;
 #endif
 
@@ -248,7 +456,17 @@ Cleanup()
     delete timer;
     delete scheduler;
     delete interrupt;
+    if (replayLog != NULL) {		// finish the log, or say how
+	delete replayLog;		// well the replay followed it
+	replayLog = NULL;
+    }
+    if (eventTrace != NULL) {		// write out the trace
+	delete eventTrace;
+	eventTrace = NULL;
+    }
     
+    if (haltPoint != NULL)
+	longjmp(*haltPoint, 1);
     Exit(0);
 }
 
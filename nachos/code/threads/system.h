@@ -1,6 +1,10 @@
 // system.h 
 //	All global variables used in Nachos are defined here.
 //
+//	They are all thread_local: each host thread that runs a simulation
+//	(see RunNachos in nachos.h) has its own copy, so one program can
+//	run many independent simulated machines side by side.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -15,6 +19,9 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "replay.h"
+#include "trace.h"
+#include <setjmp.h>
 
 #define MAX_THREAD_COUNT 1000
 
@@ -24,31 +31,35 @@ extern void Initialize(int argc, char **argv); 	// Initialization,
 extern void Cleanup();				// Cleanup, called when
 						// Nachos is done.
 
-extern NachOSThread *currentThread;			// the thread holding the CPU
-extern NachOSThread *threadToBeDestroyed;  		// the thread that just finished
-extern NachOSscheduler *scheduler;			// the ready list
-extern Interrupt *interrupt;			// interrupt status
-extern Statistics *stats;			// performance metrics
-extern Timer *timer;				// the hardware alarm clock
-extern unsigned numPagesAllocated;              // number of physical frames allocated
-extern int scheduler_type;
-extern NachOSThread *threadArray[];  			// Array of thread pointers
-extern unsigned thread_index;                  // Index into this array (also used to assign unique pid)
-extern bool initializedConsoleSemaphores;       // Used to initialize the semaphores for console I/O exactly once
-extern bool exitThreadArray[];          // Marks exited threads
-extern int process_start_time;
-
-extern int total_burst;
-extern int total_max_burst;
-extern int total_min_burst;
-extern int total_burst_count;
-extern int system_start_time;
-extern int total_ready_queue_waittime;
-
-extern int total_thread_time;
-extern int total_max_thread_time;
-extern int total_min_thread_time;
-extern int thread_count;
+extern thread_local NachOSThread *currentThread;			// the thread holding the CPU
+extern thread_local NachOSThread *threadToBeDestroyed;  		// the thread that just finished
+extern thread_local NachOSscheduler *scheduler;			// the ready list
+extern thread_local Interrupt *interrupt;			// interrupt status
+extern thread_local Statistics *stats;			// performance metrics
+extern thread_local Timer *timer;				// the hardware alarm clock
+extern thread_local ReplayLog *replayLog;		// the interrupts being recorded
+						// or replayed, or NULL
+extern thread_local EventTrace *eventTrace;		// the kernel's events, or NULL
+extern thread_local unsigned numPagesAllocated;              // number of physical frames in use
+extern thread_local int scheduler_type;
+extern thread_local int quantum;				// time slice for scheduler types 1 and 2
+extern thread_local NachOSThread *threadArray[];  			// Array of thread pointers
+extern thread_local unsigned thread_index;                  // Index into this array (also used to assign unique pid)
+extern thread_local bool initializedConsoleSemaphores;       // Used to initialize the semaphores for console I/O exactly once
+extern thread_local bool exitThreadArray[];          // Marks exited threads
+extern thread_local int process_start_time;
+
+extern thread_local int total_burst;
+extern thread_local int total_max_burst;
+extern thread_local int total_min_burst;
+extern thread_local int total_burst_count;
+extern thread_local int system_start_time;
+extern thread_local int total_ready_queue_waittime;
+
+extern thread_local int total_thread_time;
+extern thread_local int total_max_thread_time;
+extern thread_local int total_min_thread_time;
+extern thread_local int thread_count;
 class TimeSortedWaitQueue {             // Needed to implement SYScall_Sleep
 private:
    NachOSThread *t;                           // Thread pointer of the sleeping thread
@@ -65,26 +76,57 @@ public:
    void SetNext (TimeSortedWaitQueue *n) { next = n; }
 };
 
-extern TimeSortedWaitQueue *sleepQueueHead;
+extern thread_local TimeSortedWaitQueue *sleepQueueHead;
+
+extern thread_local jmp_buf *haltPoint;	// where Cleanup goes when the
+						// simulation is over (see RunNachos)
 
 #ifdef USER_PROGRAM
 #include "machine.h"
-extern Machine* machine;	// user program memory and registers
+#include "profile.h"
+#include "checkpoint.h"
+#include "bitmap.h"
+extern thread_local Machine* machine;	// user program memory and registers
+extern thread_local Profiler *profiler;	// where user programs spend their time,
+				// or NULL if we're not profiling
+extern thread_local char *checkpointFile;	// where to save a checkpoint, or NULL
+extern thread_local int checkpointTime;	// and the earliest time to take it
+extern thread_local BitMap *frameMap;	// which physical frames are in use
+#ifdef VM
+#include "frametable.h"
+#include "swapspace.h"
+extern thread_local int *frameReferences;	// how many page table entries
+				// map each physical frame
+extern thread_local FrameTable *frameTable;	// which page each frame holds
+extern thread_local NachOSThread *pageCleaner;	// writes dirty pages out
+				// ahead of eviction, once memory is full
+extern thread_local SwapSpace *swapSpace;	// where they are written
+#endif
+#ifdef USE_TLB
+extern thread_local int nextASID;		// the ID the next address
+						// space gets, for the TLB
+#endif
+#ifdef INVERTED_PAGE_TABLE
+#include "invertedpt.h"
+extern thread_local InvertedPageTable *invertedPageTable;
+					// the pages of every address space
+					// that are in memory
+#endif
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
 #include "filesys.h"
-extern FileSystem  *fileSystem;
+extern thread_local FileSystem  *fileSystem;
 #endif
 
 #ifdef FILESYS
 #include "synchdisk.h"
-extern SynchDisk   *synchDisk;
+extern thread_local SynchDisk   *synchDisk;
 #endif
 
 #ifdef NETWORK
 #include "post.h"
-extern PostOffice* postOffice;
+extern thread_local PostOffice* postOffice;
 #endif
 
 #endif // SYSTEM_H
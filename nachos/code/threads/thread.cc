@@ -20,7 +20,7 @@
 #include "synch.h"
 #include "system.h"
 
-#define STACK_FENCEPOST 0xdeadbeef	// this is put at the top of the
+#define STACK_FENCEPOST ((intptr_t) 0xdeadbeef)	// this is put at the top of the
 					// execution stack, for detecting 
 					// stack overflows
 
@@ -54,6 +54,7 @@ NachOSThread::NachOSThread(char* threadName)
 #ifdef USER_PROGRAM
     space = NULL;
     stateRestored = true;
+    resumePoint = ResumeInKernel;
 #endif
 
     threadArray[thread_index] = this;
@@ -85,6 +86,9 @@ NachOSThread::NachOSThread(char* threadName)
 //      NOTE: if this is the main thread, we can't delete the stack
 //      because we didn't allocate it -- we got it automatically
 //      as part of starting up Nachos.
+//
+//	A user program's address space goes with it, which frees its
+//	physical frames for other programs.
 //----------------------------------------------------------------------
 
 NachOSThread::~NachOSThread()
@@ -93,7 +97,11 @@ NachOSThread::~NachOSThread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	DeallocBoundedArray((char *) stack, StackSize * sizeof(intptr_t));
+#ifdef USER_PROGRAM
+    if (space != NULL)
+	delete space;
+#endif
     DEBUG('t', "Deleted Successfully\n");
 }
 
@@ -118,10 +126,10 @@ NachOSThread::~NachOSThread()
 //----------------------------------------------------------------------
 
 void 
-NachOSThread::ThreadFork(VoidFunctionPtr func, int arg)
+NachOSThread::ThreadFork(VoidFunctionPtr func, intptr_t arg)
 {
-    DEBUG('t', "Forking thread \"%s\" with pid %d with func = 0x%x, arg = %d\n",
-	  name, pid, (int) func, arg);
+    DEBUG('t', "Forking thread \"%s\" with pid %d with func = %p, arg = %ld\n",
+	  name, pid, func, (long) arg);
     
     AllocateThreadStack(func, arg);
 
@@ -209,7 +217,6 @@ NachOSThread::SetChildExitCode (int childpid, int ecode)
    exitedChild[i] = true;
 
    if (waitchild_id == (int)i) {
-      waitchild_id = -1;
       // I will wake myself up
       IntStatus oldLevel = interrupt->SetLevel(IntOff);
       scheduler->ThreadIsReadyToRun(this);
@@ -257,14 +264,17 @@ NachOSThread::Exit (bool terminateSim, int exitcode)
     status = BLOCKED;
 
     // Set exit code in parent's structure provided the parent hasn't exited
-    if (ppid != -1) {
+    // (an exited parent has been deleted, and may not be in threadArray)
+    if ((ppid != -1) && !exitThreadArray[ppid]) {
        ASSERT(threadArray[ppid] != NULL);
-       if (!exitThreadArray[ppid]) {
-          threadArray[ppid]->SetChildExitCode (pid, exitcode);
-       }
+       threadArray[ppid]->SetChildExitCode (pid, exitcode);
     }
 
-    while ((nextThread = scheduler->FindNextThreadToRun()) == NULL) {
+    // Once every thread has exited, the only one that can be ready is a
+    // kernel thread that Exit doesn't wait for (the vm build's page
+    // cleaner), which has nothing left to do: stop anyway.
+    while (terminateSim
+	   || ((nextThread = scheduler->FindNextThreadToRun()) == NULL)) {
         if (terminateSim) {
            DEBUG('i', "Machine idle.  No interrupts to do.\n");
            printf("\nNo threads ready or runnable, and no pending interrupts.\n");
@@ -380,9 +390,10 @@ NachOSThread::PutThreadToSleep ()
 
 static void ThreadFinish()    { currentThread->FinishThread(); }
 static void InterruptEnable() { interrupt->Enable(); }
-void ThreadPrint(int arg){ NachOSThread *t = (NachOSThread *)arg; t->Print(); }
+static void InterruptsStayOff() { }
+void ThreadPrint(intptr_t arg){ NachOSThread *t = (NachOSThread *)arg; t->Print(); }
 
-void SetP(int arg){ 
+void SetP(intptr_t arg){ 
   NachOSThread *t = (NachOSThread *)arg;
   t->SetPriority(); 
 }
@@ -400,9 +411,9 @@ void SetP(int arg){
 //----------------------------------------------------------------------
 
 void
-NachOSThread::AllocateThreadStack (VoidFunctionPtr func, int arg)
+NachOSThread::AllocateThreadStack (VoidFunctionPtr func, intptr_t arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    stack = (intptr_t *) AllocBoundedArray(StackSize * sizeof(intptr_t));
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
@@ -413,24 +424,39 @@ NachOSThread::AllocateThreadStack (VoidFunctionPtr func, int arg)
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
     stackTop = stack + StackSize - 96;
-#else  // HOST_MIPS  || HOST_i386
+#else  // HOST_MIPS  || HOST_i386 || HOST_x86_64
     stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
-#ifdef HOST_i386
+#if defined(HOST_i386) || defined(HOST_x86_64)
     // the 80386 passes the return address on the stack.  In order for
     // SWITCH() to go to ThreadRoot when we switch to this thread, the
     // return addres used in SWITCH() must be the starting address of
     // ThreadRoot.
-    *(--stackTop) = (int)_ThreadRoot;
+    *(--stackTop) = (intptr_t)_ThreadRoot;
 #endif
 #endif  // HOST_SPARC
     *stack = STACK_FENCEPOST;
 #endif  // HOST_SNAKE
     
-    machineState[PCState] = (int) _ThreadRoot;
-    machineState[StartupPCState] = (int) InterruptEnable;
-    machineState[InitialPCState] = (int) func;
+    machineState[PCState] = (intptr_t) _ThreadRoot;
+    machineState[StartupPCState] = (intptr_t) InterruptEnable;
+    machineState[InitialPCState] = (intptr_t) func;
     machineState[InitialArgState] = arg;
-    machineState[WhenDonePCState] = (int) ThreadFinish;
+    machineState[WhenDonePCState] = (intptr_t) ThreadFinish;
+}
+
+//----------------------------------------------------------------------
+// NachOSThread::ResumeThreadStack
+//	Like AllocateThreadStack, but leave interrupts off when "func"
+//	starts, as they are when a thread that gave up the CPU gets it
+//	back.  "func" can then carry on exactly as that thread would have;
+//	it must turn interrupts back on itself.
+//----------------------------------------------------------------------
+
+void
+NachOSThread::ResumeThreadStack (VoidFunctionPtr func, intptr_t arg)
+{
+    AllocateThreadStack(func, arg);
+    machineState[StartupPCState] = (intptr_t) InterruptsStayOff;
 }
 
 #ifdef USER_PROGRAM
@@ -469,6 +495,7 @@ NachOSThread::RestoreUserState()
 {
     for (int i = 0; i < NumTotalRegs; i++)
 	machine->WriteRegister(i, userRegisters[i]);
+    machine->ForgetLastLoad();		// for the cost model
     stateRestored = true;
 }
 #endif
@@ -509,12 +536,29 @@ NachOSThread::JoinWithChild (int whichchild)
       IntStatus oldLevel = interrupt->SetLevel(IntOff);
       printf("[pid %d] Before sleep in JoinWithChild.\n", pid);
       PutThreadToSleep();
-      printf("[pid %d] After sleep in JoinWithChild.\n", pid);
+      (void) FinishJoin();
       (void) interrupt->SetLevel(oldLevel);
    }
    return childexitcode[whichchild];
 }
 
+//----------------------------------------------------------------------
+// NachOSThread::FinishJoin
+//      Called by JoinWithChild once the child has exited and woken us
+//      up, and by a thread restored from a checkpoint taken while it
+//      was asleep in Join.  Returns the exit code of the child.
+//----------------------------------------------------------------------
+
+int
+NachOSThread::FinishJoin ()
+{
+   int whichchild = waitchild_id;
+
+   waitchild_id = -1;
+   printf("[pid %d] After sleep in JoinWithChild.\n", pid);
+   return childexitcode[whichchild];
+}
+
 #ifdef USER_PROGRAM
 //----------------------------------------------------------------------
 // NachOSThread::ResetReturnValue
@@ -527,6 +571,85 @@ NachOSThread::ResetReturnValue ()
 {
    userRegisters[2] = 0;
 }
+
+//----------------------------------------------------------------------
+// NachOSThread::Checkpoint
+//      Write everything about this thread, including its address space,
+//      to the checkpoint file "fd".  Its kernel stack isn't saved; a
+//      restored thread gets a new one, and starts again from the point
+//      given by "resumePoint".
+//----------------------------------------------------------------------
+
+void
+NachOSThread::Checkpoint (int fd)
+{
+   int length = strlen(name) + 1;
+   int fields[] = { pid, ppid, priority, status, CPU_ticks,
+                    UNIX_BasePriority, UNIX_Priority, burst, burst_count,
+                    max_burst, min_burst, wait_time_ready_queue,
+                    start_time_ready_queue, times_entered_ready_queue,
+                    next_estimation, previous_estimation, thread_start_time,
+                    thread_end_time, previous_burst, (int)childcount,
+                    waitchild_id, (int)instructionCount, stateRestored,
+                    resumePoint, space != NULL };
+
+   WriteFile(fd, (char *)&length, sizeof(int));
+   WriteFile(fd, name, length);
+   WriteFile(fd, (char *)fields, sizeof(fields));
+   WriteFile(fd, (char *)childpidArray, sizeof(childpidArray));
+   WriteFile(fd, (char *)childexitcode, sizeof(childexitcode));
+   WriteFile(fd, (char *)exitedChild, sizeof(exitedChild));
+   WriteFile(fd, (char *)userRegisters, sizeof(userRegisters));
+   if (space != NULL)
+      space->Checkpoint(fd);
+}
+
+//----------------------------------------------------------------------
+// NachOSThread::Restore
+//      Read back a thread saved by Checkpoint, replacing everything
+//      about this one except its kernel stack.
+//----------------------------------------------------------------------
+
+void
+NachOSThread::Restore (int fd)
+{
+   int length;
+   int fields[25];
+
+   Read(fd, (char *)&length, sizeof(int));
+   name = new char[length];
+   Read(fd, name, length);
+   Read(fd, (char *)fields, sizeof(fields));
+   pid = fields[0];
+   ppid = fields[1];
+   priority = fields[2];
+   status = (ThreadStatus)fields[3];
+   CPU_ticks = fields[4];
+   UNIX_BasePriority = fields[5];
+   UNIX_Priority = fields[6];
+   burst = fields[7];
+   burst_count = fields[8];
+   max_burst = fields[9];
+   min_burst = fields[10];
+   wait_time_ready_queue = fields[11];
+   start_time_ready_queue = fields[12];
+   times_entered_ready_queue = fields[13];
+   next_estimation = fields[14];
+   previous_estimation = fields[15];
+   thread_start_time = fields[16];
+   thread_end_time = fields[17];
+   previous_burst = fields[18];
+   childcount = fields[19];
+   waitchild_id = fields[20];
+   instructionCount = fields[21];
+   stateRestored = fields[22];
+   resumePoint = (ResumePoint)fields[23];
+   Read(fd, (char *)childpidArray, sizeof(childpidArray));
+   Read(fd, (char *)childexitcode, sizeof(childexitcode));
+   Read(fd, (char *)exitedChild, sizeof(exitedChild));
+   Read(fd, (char *)userRegisters, sizeof(userRegisters));
+   space = fields[24] ? new ProcessAddrSpace(fd) : NULL;
+}
 #endif
 
 //----------------------------------------------------------------------
@@ -603,14 +726,16 @@ NachOSThread::SortedInsertInWaitQueue (unsigned when)
 }
 
 //----------------------------------------------------------------------
-// NachOSThread::IncInstructionCount
-//      Called by Machine::Run to update instruction count
+// NachOSThread::AddInstructionCount
+//      Called by the block cache to charge a whole block of
+//      instructions at once ("count" may be negative, to take back
+//      the part of a block that didn't run)
 //----------------------------------------------------------------------
 
 void
-NachOSThread::IncInstructionCount (void)
+NachOSThread::AddInstructionCount (int count)
 {
-   instructionCount++;
+   instructionCount += count;
 }
 
 //----------------------------------------------------------------------
@@ -670,12 +795,18 @@ NachOSThread::GetNextEstimation ()
 {
    return next_estimation;
 }
+// Called as the thread goes on and comes off the ready list; these
+// are also where the event trace sees it do so.
 void 
 NachOSThread::set_start_time_ready_queue(){
   start_time_ready_queue = stats->totalTicks;
   times_entered_ready_queue ++;
+  if (eventTrace != NULL)
+    eventTrace->Record(TraceReady, pid, 0);
 }
 void 
 NachOSThread::add_wait_time_ready_queue(){
   wait_time_ready_queue += stats->totalTicks - start_time_ready_queue;
+  if (eventTrace != NULL)
+    eventTrace->Record(TraceDequeue, pid, 0);
 }
\ No newline at end of file
@@ -45,6 +45,23 @@
 #ifdef USER_PROGRAM
 #include "machine.h"
 #include "addrspace.h"
+
+class Console;
+
+// What a Print system call still has to write, kept in the thread so
+// that it can be saved in a checkpoint while the thread waits for the
+// console (see WriteOutput in exception.cc).
+
+#define MaxOutputChars	16	// enough for any PrintInt or PrintIntHex
+
+class PendingOutput {
+  public:
+    Console *console;			// where it is going
+    char chars[MaxOutputChars];		// chars[next] up to chars[count-1]
+    int next, count;			// are still to be written...
+    int stringAddr;			// ...then the string following this
+					// address in user memory, unless -1
+};
 #endif
 
 // CPU register state to be saved on context switch.  
@@ -55,15 +72,25 @@
 
 // Size of the thread's private execution stack.
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
-#define StackSize	(4 * 1024)	// in words
+#define StackSize	(4 * 1024)	// in words (host pointer-sized)
 
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
+// Where a user thread that has given up the CPU will pick up again.
+// A checkpoint can only be taken when no thread is stopped anywhere
+// else in the kernel (see userprog/checkpoint.cc).
+enum ResumePoint { ResumeInKernel,	// somewhere in the middle of the kernel
+		   ResumeInUser,	// in Machine::Run, between instructions
+		   ResumeAfterSyscall,	// in Yield or Sleep, about to return
+		   ResumeInJoin,	// asleep in Join
+		   ResumeInPrint };	// waiting for the console, part way
+					// through a Print call
+
 // external function, dummy routine whose sole job is to call NachOSThread::Print
-extern void ThreadPrint(int arg);	 
-extern void SetP(int arg);
+extern void ThreadPrint(intptr_t arg);	 
+extern void SetP(intptr_t arg);
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -79,8 +106,8 @@ class NachOSThread {
   private:
     // NOTE: DO NOT CHANGE the order of these first two members.
     // THEY MUST be in this position for SWITCH to work.
-    int* stackTop;			 // the current stack pointer
-    int machineState[MachineStateSize];  // all registers except for stackTop
+    intptr_t* stackTop;			 // the current stack pointer
+    intptr_t machineState[MachineStateSize];  // all registers except for stackTop
 
   public:
     int priority;
@@ -92,7 +119,7 @@ class NachOSThread {
 
     // basic thread operations
 
-    void ThreadFork(VoidFunctionPtr func, int arg); 	// Make thread run (*func)(arg)
+    void ThreadFork(VoidFunctionPtr func, intptr_t arg); 	// Make thread run (*func)(arg)
     void YieldCPU();  				// Relinquish the CPU if any 
 						// other thread is runnable
     void PutThreadToSleep();  				// Put the thread to sleep and 
@@ -121,19 +148,24 @@ class NachOSThread {
                                                         // is joining a legitimate child.
 
     int JoinWithChild (int whichchild);                 // Called by SYScall_Join
+    int FinishJoin ();                                  // The rest of JoinWithChild, once woken up
 
     void RegisterNewChild (int childpid) { childpidArray[childcount] = childpid; childcount++; ASSERT(childcount < MAX_CHILD_COUNT); }
 
     void Schedule ();                                   // Called by SYScall_Fork to enqueue the newly created child thread in the ready queue
 
-    void AllocateThreadStack(VoidFunctionPtr func, int arg);  // Allocate a stack for the simulated thread context. The thread starts execution at
+    void AllocateThreadStack(VoidFunctionPtr func, intptr_t arg);  // Allocate a stack for the simulated thread context. The thread starts execution at
                                                         // func (in kernel space) with input argument arg.
+    void ResumeThreadStack(VoidFunctionPtr func, intptr_t arg);    // The same, but func starts with interrupts still off, as they are when a
+                                                        // thread returns from a context switch; used by checkpoints
 
     void Startup();                                     // Called by the startup function of SYScall_Fork to cleanly start a forked child after it is scheduled
 
     void SortedInsertInWaitQueue (unsigned when);       // Called by SYScall_Sleep handler
 
-    void IncInstructionCount();
+    inline void IncInstructionCount (void) { instructionCount++; }
+							// Called by Machine::Run for every instruction
+    void AddInstructionCount (int count);		// Called by the block cache, once per block
     unsigned GetInstructionCount();
 
     int GetPriority();					// Gets the priority value assigned to the thread
@@ -147,7 +179,7 @@ class NachOSThread {
   private:
     // some of the private data for this class is listed above
     
-    int* stack; 	 		// Bottom of the stack 
+    intptr_t* stack; 	 		// Bottom of the stack 
 					// NULL if this is the main thread
 					// (If NULL, don't deallocate stack)
     ThreadStatus status;		// ready, running or blocked
@@ -157,7 +189,7 @@ class NachOSThread {
 
     int CPU_ticks = 0;			// CPU usage count
     int UNIX_BasePriority = 50;		// Thread's default base priority for UNIX scheduling
-    int UNIX_Priority;			// Thread's priority for UNIX scheduling
+    int UNIX_Priority = 50;		// Thread's priority for UNIX scheduling
 
     int burst;
     int burst_count;
@@ -194,10 +226,21 @@ class NachOSThread {
     void ResetReturnValue ();                           // Used by SYScall_Fork to set the return value of child to zero
 
     ProcessAddrSpace *space;			// User code this thread is running.
+    ResumePoint resumePoint;			// Where it will resume, once it
+						// has given up the CPU
+    PendingOutput output;			// What it is printing
+
+    void Checkpoint(int fd);			// Save this thread in a checkpoint
+    void Restore(int fd);			// Read it back into this thread
 #endif
 };
 
 // Magical machine-dependent routines, defined in switch.s
+//
+// These are plain assembly, so even with -flto the compiler can't see
+// into them; it has to assume that _SWITCH reads and writes any memory,
+// including machineState and the stacks.  Don't turn them into inline
+// asm without adding a "memory" clobber.
 
 extern "C" {
 // First frame on thread execution stack; 
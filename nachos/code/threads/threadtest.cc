@@ -22,12 +22,12 @@
 //----------------------------------------------------------------------
 
 void
-SimpleThread(int which)
+SimpleThread(intptr_t which)
 {
     int num;
     
     for (num = 0; num < 5; num++) {
-	printf("*** thread %d looped %d times\n", which, num);
+	printf("*** thread %d looped %d times\n", (int) which, num);
         currentThread->YieldCPU();
     }
 }
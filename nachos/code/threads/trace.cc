@@ -0,0 +1,223 @@
+// trace.cc
+//	Routines to keep a trace of kernel events in a ring buffer, and
+//	to write it out in the Chrome trace event format.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "trace.h"
+#include "system.h"
+
+// The names of the system calls, in the order of the SYScall_ codes
+// in userprog/syscall.h (SYScall_NumInstr, 50, is dealt with below).
+static char *syscallNames[] = { "Halt", "Exit", "Exec", "Join", "Create",
+			"Open", "Read", "Write", "Close", "Fork", "Yield",
+			"PrintInt", "PrintChar", "PrintString", "GetReg",
+			"GetPA", "GetPID", "GetPPID", "Sleep", "Time",
+			"PrintIntHex" };
+
+// The rows of the trace, other than one per thread
+#define InterruptRow	0
+#define DiskRow		1
+#define ThreadRow(pid)	((pid) + 2)
+
+//----------------------------------------------------------------------
+// EventTrace::EventTrace
+// 	Allocate the trace buffer.
+//
+//	"name" -- the file to write the trace to, when Nachos halts
+//----------------------------------------------------------------------
+
+EventTrace::EventTrace(char *name)
+{
+    fileName = name;
+    events = new TraceEvent[TraceBufferSize];
+    count = 0;
+}
+
+//----------------------------------------------------------------------
+// EventTrace::~EventTrace
+// 	Write out the trace, and de-allocate the buffer.
+//----------------------------------------------------------------------
+
+EventTrace::~EventTrace()
+{
+    WriteChromeTrace();
+    delete [] events;
+}
+
+//----------------------------------------------------------------------
+// EventTrace::Record
+// 	Note that something has happened, overwriting the oldest event
+//	if the buffer is full.  See TraceKind in trace.h for what "pid"
+//	and "arg" mean for each kind of event.
+//----------------------------------------------------------------------
+
+void
+EventTrace::Record(TraceKind kind, int pid, int arg)
+{
+    TraceEvent *event = &events[count++ & (TraceBufferSize - 1)];
+
+    event->when = stats->totalTicks;
+    event->kind = kind;
+    event->pid = pid;
+    event->arg = arg;
+}
+
+//----------------------------------------------------------------------
+// WriteSlice, WriteInstant, WriteCounter
+// 	Write one entry of a Chrome trace: a stretch of time from "start"
+//	to "end", a point in time, or the value of a counter.  Each is
+//	preceded by a comma, since the array of entries starts with the
+//	name of the process.
+//----------------------------------------------------------------------
+
+static void
+WriteSlice(FILE *file, char *name, int row, int start, int end)
+{
+    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+	    "\"ts\":%d,\"dur\":%d}", name, row, start, end - start);
+}
+
+static void
+WriteInstant(FILE *file, char *name, int row, int when)
+{
+    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,"
+	    "\"tid\":%d,\"ts\":%d}", name, row, when);
+}
+
+static void
+WriteCounter(FILE *file, char *name, int when, int value)
+{
+    fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"ts\":%d,"
+	    "\"args\":{\"threads\":%d}}", name, when, value);
+}
+
+//----------------------------------------------------------------------
+// EventTrace::WriteChromeTrace
+// 	Write the events in the buffer to fileName, oldest first.  Each
+//	time a thread spends running or on the ready list becomes one
+//	slice on the thread's row, from the event that starts it to the
+//	one that ends it; one that was already under way when the oldest
+//	event in the buffer happened starts there instead, and one that
+//	hasn't ended stops at the present time.  A disk request lasts
+//	until the next disk interrupt.
+//----------------------------------------------------------------------
+
+void
+EventTrace::WriteChromeTrace()
+{
+    FILE *file = fopen(fileName, "w");
+    int runStart[MAX_THREAD_COUNT];	// when each thread started running
+    int readyStart[MAX_THREAD_COUNT];	// or waiting, or -1
+    bool seen[MAX_THREAD_COUNT];	// which threads have a row
+    int readyLength = 0;		// threads on the ready list
+    int diskStart = -1, diskKind = 0, diskSector = 0;
+    unsigned first = 0;
+    int start, pid;
+    char name[40];
+
+    if (file == NULL) {
+	printf("Unable to write trace %s\n", fileName);
+	return;
+    }
+    if (count > TraceBufferSize)
+	first = count - TraceBufferSize;
+    start = (count == 0) ? 0 : events[first & (TraceBufferSize - 1)].when;
+    for (pid = 0; pid < MAX_THREAD_COUNT; pid++) {
+	runStart[pid] = readyStart[pid] = -1;
+	seen[pid] = FALSE;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+	    "\"args\":{\"name\":\"Nachos\"}}");
+    for (unsigned i = first; i < count; i++) {
+	TraceEvent *event = &events[i & (TraceBufferSize - 1)];
+
+	pid = event->pid;
+	ASSERT((pid >= 0) && (pid < MAX_THREAD_COUNT));
+	switch (event->kind) {
+	  case TraceSwitch:
+	    if (event->arg != pid) {
+		WriteSlice(file, "running", ThreadRow(event->arg),
+			   (runStart[event->arg] < 0) ? start
+						      : runStart[event->arg],
+			   event->when);
+		seen[event->arg] = TRUE;
+	    }
+	    runStart[event->arg] = -1;
+	    runStart[pid] = event->when;
+	    seen[pid] = TRUE;
+	    break;
+	  case TraceReady:
+	    readyStart[pid] = event->when;
+	    seen[pid] = TRUE;
+	    WriteCounter(file, "ready list", event->when, ++readyLength);
+	    break;
+	  case TraceDequeue:
+	    WriteSlice(file, "ready", ThreadRow(pid), (readyStart[pid] < 0)
+		       ? start : readyStart[pid], event->when);
+	    readyStart[pid] = -1;
+	    seen[pid] = TRUE;
+	    if (readyLength > 0)
+		readyLength--;
+	    WriteCounter(file, "ready list", event->when, readyLength);
+	    break;
+	  case TraceSyscall:
+	    if ((event->arg >= 0) && (event->arg < (int) (sizeof(syscallNames)
+					/ sizeof(syscallNames[0]))))
+		WriteInstant(file, syscallNames[event->arg], ThreadRow(pid),
+			     event->when);
+	    else if (event->arg == 50)
+		WriteInstant(file, "NumInstr", ThreadRow(pid), event->when);
+	    else {
+		sprintf(name, "syscall %d", event->arg);
+		WriteInstant(file, name, ThreadRow(pid), event->when);
+	    }
+	    seen[pid] = TRUE;
+	    break;
+	  case TraceInterrupt:
+	    WriteInstant(file, intTypeNames[event->arg], InterruptRow,
+			 event->when);
+	    if ((event->arg == DiskInt) && (diskStart >= 0)) {
+		sprintf(name, "%s sector %d", (diskKind == TraceDiskRead)
+			? "read" : "write", diskSector);
+		WriteSlice(file, name, DiskRow, diskStart, event->when);
+		diskStart = -1;
+	    }
+	    break;
+	  case TraceDiskRead:
+	  case TraceDiskWrite:
+	    diskStart = event->when;
+	    diskKind = event->kind;
+	    diskSector = event->arg;
+	    break;
+	}
+    }
+
+    // Close whatever is still going on, and name the rows.
+    for (pid = 0; pid < MAX_THREAD_COUNT; pid++) {
+	if (runStart[pid] >= 0)
+	    WriteSlice(file, "running", ThreadRow(pid), runStart[pid],
+		       stats->totalTicks);
+	if (readyStart[pid] >= 0)
+	    WriteSlice(file, "ready", ThreadRow(pid), readyStart[pid],
+		       stats->totalTicks);
+	if (seen[pid])
+	    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+		    "\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"pid %d\"}}",
+		    ThreadRow(pid), pid);
+    }
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+	    "\"tid\":%d,\"args\":{\"name\":\"interrupts\"}}", InterruptRow);
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+	    "\"tid\":%d,\"args\":{\"name\":\"disk\"}}", DiskRow);
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    if (count > TraceBufferSize)
+	printf("Trace %s: only the last %d of %u events were kept\n",
+	       fileName, TraceBufferSize, count);
+}
@@ -0,0 +1,73 @@
+// trace.h
+//	Data structures for a cheap trace of what the kernel does.
+//
+//	DEBUG messages are printed as they happen, which is slow enough
+//	to change what is being looked at.  With -trace <file>, Nachos
+//	instead notes each context switch, each thread put on or taken
+//	off the ready list, each system call, each interrupt and each
+//	disk request, with the time, as a small fixed-size record in a
+//	buffer allocated up front.  When the buffer fills up, the oldest
+//	records are overwritten, so only the last TraceBufferSize events
+//	are kept.
+//
+//	When Nachos halts, the buffer is written out to <file> in the
+//	Chrome trace event format, which chrome://tracing and the
+//	Perfetto UI (ui.perfetto.dev) can both display: one row per
+//	Nachos thread, showing when it was running and when it was
+//	waiting on the ready list, with its system calls marked; a row
+//	each for the interrupts and the disk; and the length of the
+//	ready list as a counter.  One tick is shown as one microsecond.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "copyright.h"
+
+#define TraceBufferSize	(1 << 18)	// events kept; a power of two
+
+// The kinds of event that are traced.
+
+enum TraceKind { TraceSwitch,		// "pid" now has the CPU, "arg" lost it
+		 TraceReady,		// "pid" put on the ready list
+		 TraceDequeue,		// "pid" taken off the ready list
+		 TraceSyscall,		// "pid" made system call "arg"
+		 TraceInterrupt,	// an interrupt of IntType "arg"
+		 TraceDiskRead,		// a request to read sector "arg"
+		 TraceDiskWrite };	// a request to write sector "arg"
+
+// One event, as kept in the buffer.
+
+class TraceEvent {
+  public:
+    int when;			// stats->totalTicks at the time
+    int kind;			// a TraceKind
+    int pid;			// the thread concerned, if any
+    int arg;			// and what else there is to know
+};
+
+// The following class defines the trace buffer.
+
+class EventTrace {
+  public:
+    EventTrace(char *name);		// trace into a new buffer, to be
+					// written to file "name"
+    ~EventTrace();			// write the buffer out, and
+					// de-allocate it
+
+    void Record(TraceKind kind, int pid, int arg);	// note an event
+
+  private:
+    char *fileName;
+    TraceEvent *events;			// the buffer
+    unsigned count;			// events recorded so far; the
+					// next goes in events[count %
+					// TraceBufferSize]
+
+    void WriteChromeTrace();		// write the buffer to fileName
+};
+
+#endif // TRACE_H
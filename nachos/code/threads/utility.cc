@@ -21,7 +21,7 @@
 #endif
 #endif
 
-static char *enableFlags = NULL; // controls which DEBUG messages are printed 
+thread_local uint64_t debugFlags[2];	// controls which DEBUG messages are printed 
 
 //----------------------------------------------------------------------
 // DebugInit
@@ -37,39 +37,36 @@ static char *enableFlags = NULL; // controls which DEBUG messages are printed
 void
 DebugInit(char *flagList)
 {
-    enableFlags = flagList;
-}
-
-//----------------------------------------------------------------------
-// DebugIsEnabled
-//      Return TRUE if DEBUG messages with "flag" are to be printed.
-//----------------------------------------------------------------------
-
-bool
-DebugIsEnabled(char flag)
-{
-    if (enableFlags != NULL)
-       return (strchr(enableFlags, flag) != 0) 
-		|| (strchr(enableFlags, '+') != 0);
-    else
-      return FALSE;
+    debugFlags[0] = debugFlags[1] = 0;
+    if (flagList == NULL)
+	return;
+#ifdef NO_DEBUG
+    if (*flagList != '\0')
+	printf("DEBUG messages are compiled out of this build; ignoring -d\n");
+#else
+    for (char *flag = flagList; *flag != '\0'; flag++) {
+	if (*flag == '+') {
+	    debugFlags[0] = debugFlags[1] = ~(uint64_t)0;
+	    break;
+	}
+	debugFlags[(*flag >> 6) & 1] |= (uint64_t)1 << (*flag & 63);
+    }
+#endif
 }
 
 //----------------------------------------------------------------------
-// DEBUG
-//      Print a debug message, if flag is enabled.  Like printf,
-//	only with an extra argument on the front.
+// DebugPrint
+//      Print a debug message; DEBUG has already checked its flag.
+//	Like printf.
 //----------------------------------------------------------------------
 
 void 
-DEBUG(char flag, char *format, ...)
+DebugPrint(char *format, ...)
 {
-    if (DebugIsEnabled(flag)) {
-	va_list ap;
-	// You will get an unused variable message here -- ignore it.
-	va_start(ap, format);
-	vfprintf(stdout, format, ap);
-	va_end(ap);
-	fflush(stdout);
-    }
+    va_list ap;
+    // You will get an unused variable message here -- ignore it.
+    va_start(ap, format);
+    vfprintf(stdout, format, ap);
+    va_end(ap);
+    fflush(stdout);
 }
@@ -15,6 +15,14 @@
 //   	'f' -- file system (FILESYS)
 //   	'a' -- address spaces (USER_PROGRAM)
 //   	'n' -- network emulation (NETWORK)
+//   	'b' -- block cache (USER_PROGRAM)
+//   	'c' -- cache model (USER_PROGRAM)
+//
+//	DEBUG is a macro, so that it costs next to nothing when its flag
+//	is off: one test of a bit in debugFlags, with the arguments only
+//	evaluated if the message is to be printed.  In a build with
+//	NO_DEBUG defined ("gmake optimized"), DEBUG and DebugIsEnabled
+//	compile to nothing at all, and -d has no effect.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -55,8 +63,14 @@
 //
 // This is used by NachOSThread::ThreadFork and for interrupt handlers, as well
 // as a couple of other places.
+//
+// The argument is an "intptr_t" rather than an "int", since callers
+// routinely pass an object pointer through it (e.g., "(intptr_t) this"),
+// and on a 64-bit host a pointer does not fit in an int.
+
+#include <stdint.h>
 
-typedef void (*VoidFunctionPtr)(int arg); 
+typedef void (*VoidFunctionPtr)(intptr_t arg); 
 typedef void (*VoidNoArgFunctionPtr)(); 
 
 
@@ -68,10 +82,44 @@ typedef void (*VoidNoArgFunctionPtr)();
 
 extern void DebugInit(char* flags);	// enable printing debug messages
 
-extern bool DebugIsEnabled(char flag); 	// Is this debug flag enabled?
+extern void DebugPrint(char* format, ...);	// print a debug message,
+						// regardless of its flag
 
-extern void DEBUG (char flag, char* format, ...);  	// Print debug message 
-							// if flag is enabled
+extern thread_local uint64_t debugFlags[2];	// bit c is set if flag c
+						// is enabled (for ASCII c)
+
+//----------------------------------------------------------------------
+// DebugIsEnabled
+//      Is this debug flag enabled?
+//
+// DEBUG
+//      Print a debug message, if flag is enabled.  Like printf,
+//	only with an extra argument on the front.
+//----------------------------------------------------------------------
+
+#ifdef NO_DEBUG
+inline bool DebugIsEnabled(char flag) { return FALSE; }
+
+// The message is still compiled, so that it is checked, and so that
+// variables only used in messages don't draw warnings; but it is
+// dead code, and gets thrown away.
+#define DEBUG(flag, ...)						      \
+    do {								      \
+	if (0)								      \
+	    DebugPrint(__VA_ARGS__);					      \
+    } while (0)
+#else
+inline bool DebugIsEnabled(char flag)
+{
+    return (debugFlags[(flag >> 6) & 1] >> (flag & 63)) & 1;
+}
+
+#define DEBUG(flag, ...)						      \
+    do {								      \
+	if (DebugIsEnabled(flag))					      \
+	    DebugPrint(__VA_ARGS__);					      \
+    } while (0)
+#endif
 
 //----------------------------------------------------------------------
 // ASSERT
@@ -42,6 +42,70 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+//----------------------------------------------------------------------
+// AllocateFrame, FreeFrame
+// 	Take a free physical frame for a page, or give one back, keeping
+//	count of how many are in use.
+//----------------------------------------------------------------------
+
+static int
+AllocateFrame()
+{
+    int frame = frameMap->Find();
+
+    ASSERT(frame != -1);		// out of memory (the vm build makes
+					// room first: see NewFrame)
+    numPagesAllocated++;
+    stats->numFramesAllocated++;
+    if ((int) numPagesAllocated > stats->maxFramesInUse)
+	stats->maxFramesInUse = numPagesAllocated;
+    return frame;
+}
+
+static void
+FreeFrame(int frame)
+{
+    ASSERT(frameMap->Test(frame));
+    frameMap->Clear(frame);
+    numPagesAllocated--;
+    stats->numFramesFreed++;
+#ifdef VM
+    frameTable->Released(frame);
+#endif
+}
+
+#ifndef VM
+//----------------------------------------------------------------------
+// LoadSegment
+// 	Copy a segment of the program file into the frames of the pages
+//	it covers, one page at a time, since the frames of an address
+//	space needn't be next to each other.
+//
+//	"executable" -- the program file
+//	"segment" -- where the segment is in the file, and where it goes
+//	"pageTable" -- the address space's page table
+//----------------------------------------------------------------------
+
+static void
+LoadSegment(OpenFile *executable, Segment *segment, TranslationEntry *pageTable)
+{
+    int vaddr = segment->virtualAddr;
+    int end = segment->virtualAddr + segment->size;
+    int length;
+
+    while (vaddr < end) {
+	length = PageSize - vaddr % PageSize;
+	if (length > end - vaddr)
+	    length = end - vaddr;
+	executable->ReadAt(&(machine->mainMemory[pageTable[vaddr / PageSize]
+				.physicalPage * PageSize + vaddr % PageSize]),
+			   length, segment->inFileAddr
+				+ (vaddr - segment->virtualAddr));
+	vaddr += length;
+    }
+}
+#endif
+
 //----------------------------------------------------------------------
 // ProcessAddrSpace::ProcessAddrSpace
 // 	Create an address space to run a user program.
@@ -54,16 +118,21 @@ SwapHeader (NoffHeader *noffH)
 //	memory.  For now, this is really simple (1:1), since we are
 //	only uniprogramming, and we have a single unsegmented page table
 //
+//	In the vm build, nothing is loaded yet: every page starts out
+//	invalid, and is read in from the program file (or zeroed) the
+//	first time it is touched; see HandlePageFault.  The address space
+//	then keeps "executable", and closes it when it is done with it --
+//	unless another process is already running the same program, in
+//	which case the two share that process's image of the program
+//	(and the frames of its code), and "executable" is closed now.
+//
 //	"executable" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
 
 ProcessAddrSpace::ProcessAddrSpace(OpenFile *executable)
 {
     NoffHeader noffH;
-    unsigned int i, size;
-    unsigned vpn, offset;
-    TranslationEntry *entry;
-    unsigned int pageFrame;
+    unsigned int size;
 
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -76,61 +145,80 @@ ProcessAddrSpace::ProcessAddrSpace(OpenFile *executable)
 			+ UserStackSize;	// we need to increase the size
 						// to leave room for the stack
     numPagesInVM = divRoundUp(size, PageSize);
+    unusedBytes = numPagesInVM * PageSize - size;
+    CountUnusedBytes(unusedBytes);
+    CountPageTableEntries(numPagesInVM);
     size = numPagesInVM * PageSize;
 
-    ASSERT(numPagesInVM+numPagesAllocated <= NumPhysPages);		// check we're not trying
+#ifdef VM
+    DEBUG('a', "Initializing address space, num pages %d, size %d, "
+	  "demand paged\n", numPagesInVM, size);
+    image = FindProgramImage(executable);
+    if (image != NULL) {
+	DEBUG('a', "Sharing the image of a program already running\n");
+	delete executable;
+	image->AddReference();
+    } else
+	image = new ProgramImage(executable, &noffH);
+    backingStore = new BackingStore(numPagesInVM);
+#ifdef USE_TLB
+    asid = nextASID++;
+    tlbHits = tlbMisses = 0;
+#endif
+    InitPageTable();
+#else
+    ASSERT(numPagesInVM <= (unsigned) frameMap->NumClear());
+						// check we're not trying
 						// to run anything too big --
 						// at least until we have
 						// virtual memory
 
-    DEBUG('a', "Initializing address space, num pages %d, size %d, after physicalPage = %d\n", 
-					numPagesInVM, size,numPagesAllocated);
-// first, set up the translation 
+    DEBUG('a', "Initializing address space, num pages %d, size %d, %d frames in use\n", 
+					numPagesInVM, size, numPagesAllocated);
+// first, set up the translation, and zero out the entire address space,
+// to zero the unitialized data segment and the stack segment
     NachOSpageTable = new TranslationEntry[numPagesInVM];
-    for (i = 0; i < numPagesInVM; i++) {
+    for (unsigned i = 0; i < numPagesInVM; i++) {
 	NachOSpageTable[i].virtualPage = i;
-	NachOSpageTable[i].physicalPage = i+numPagesAllocated;
+	NachOSpageTable[i].physicalPage = AllocateFrame();
 	NachOSpageTable[i].valid = TRUE;
 	NachOSpageTable[i].use = FALSE;
 	NachOSpageTable[i].dirty = FALSE;
 	NachOSpageTable[i].readOnly = FALSE;  // if the code segment was entirely on 
 					// a separate page, we could set its 
 					// pages to be read-only
+	bzero(&machine->mainMemory[NachOSpageTable[i].physicalPage * PageSize],
+	      PageSize);
+	machine->InvalidateCachedCode(NachOSpageTable[i].physicalPage);
     }
-    
-// zero out the entire address space, to zero the unitialized data segment 
-// and the stack segment
-    bzero(&machine->mainMemory[numPagesAllocated*PageSize], size);
-
-    numPagesAllocated += numPagesInVM;
 
 // then, copy in the code and data segments into memory
+#ifdef FILESYS_STUB
+    executable->MapForReading();	// rather than a system call or two
+					// for each page
+#endif
     if (noffH.code.size > 0) {
         DEBUG('a', "Initializing code segment, at 0x%x, size %d\n", 
 			noffH.code.virtualAddr, noffH.code.size);
-        vpn = noffH.code.virtualAddr/PageSize;
-        offset = noffH.code.virtualAddr%PageSize;
-        entry = &NachOSpageTable[vpn];
-        pageFrame = entry->physicalPage;
-        executable->ReadAt(&(machine->mainMemory[pageFrame * PageSize + offset]),
-                        noffH.code.size, noffH.code.inFileAddr);
+        LoadSegment(executable, &noffH.code, NachOSpageTable);
     }
     if (noffH.initData.size > 0) {
         DEBUG('a', "Initializing data segment, at 0x%x, size %d\n", 
 			noffH.initData.virtualAddr, noffH.initData.size);
-        vpn = noffH.initData.virtualAddr/PageSize;
-        offset = noffH.initData.virtualAddr%PageSize;
-        entry = &NachOSpageTable[vpn];
-        pageFrame = entry->physicalPage;
-        executable->ReadAt(&(machine->mainMemory[pageFrame * PageSize + offset]),
-                        noffH.initData.size, noffH.initData.inFileAddr);
+        LoadSegment(executable, &noffH.initData, NachOSpageTable);
     }
-
+#endif // VM
 }
 
 //----------------------------------------------------------------------
 // ProcessAddrSpace::ProcessAddrSpace (ProcessAddrSpace*) is called by a forked thread.
 //      We need to duplicate the address space of the parent.
+//
+//	In the vm build, nothing is copied.  The pages the parent has in
+//	memory are shared, read-only in both address spaces, until one of
+//	them writes to a page; then it gets its own copy of that page
+//	(see CopyOnWrite).  The child reads the pages the parent hasn't
+//	touched from the parent's program file, when it needs them.
 //----------------------------------------------------------------------
 
 ProcessAddrSpace::ProcessAddrSpace(ProcessAddrSpace *parentSpace)
@@ -138,49 +226,168 @@ ProcessAddrSpace::ProcessAddrSpace(ProcessAddrSpace *parentSpace)
     numPagesInVM = parentSpace->GetNumPages();
     unsigned i, size = numPagesInVM * PageSize;
 
-    ASSERT(numPagesInVM+numPagesAllocated <= NumPhysPages);                // check we're not trying
-
-// to run anything too big --
-
-// at least until we have
+    unusedBytes = parentSpace->unusedBytes;
+    CountUnusedBytes(unusedBytes);
+    CountPageTableEntries(numPagesInVM);
+
+#ifdef VM
+    TranslationEntry *parentEntry;	// the parent's entries don't move
+					// as we add ours (see invertedpt.h)
+
+    DEBUG('a', "Forking address space, num pages %d, size %d\n",
+	  numPagesInVM, size);
+    image = parentSpace->image;
+    image->AddReference();
+    backingStore = new BackingStore(parentSpace->backingStore);
+#ifdef USE_TLB
+    asid = nextASID++;
+    tlbHits = tlbMisses = 0;
+#endif
+    InitPageTable();
+    for (i = 0; i < numPagesInVM; i++) {
+	parentEntry = parentSpace->GetPageEntry(i);
+	if (parentEntry == NULL)
+	    continue;
+	parentEntry->readOnly = TRUE;
+	frameReferences[parentEntry->physicalPage]++;
+	stats->numPagesShared++;
+	*MapPage(i, parentEntry->physicalPage) = *parentEntry;
+    }
 
-// virtual memory
+    // The parent is running, and the host TLB (and the TLB) may let it
+    // write to the pages that have just become read-only.
+    machine->FlushHostTLB();
+#ifdef USE_TLB
+    machine->FlushTLB(parentSpace->asid);
+#endif
+#else
+    ASSERT(numPagesInVM <= (unsigned) frameMap->NumClear());
+						// check we're not trying
+						// to run anything too big --
+						// at least until we have
+						// virtual memory
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n",
                                         numPagesInVM, size);
 
-    // first, set up the translation
+    // Set up the translation, and copy the contents a page at a time
     TranslationEntry* parentPageTable = parentSpace->GetPageTable();
     NachOSpageTable = new TranslationEntry[numPagesInVM];
     for (i = 0; i < numPagesInVM; i++) {
         NachOSpageTable[i].virtualPage = i;
-        NachOSpageTable[i].physicalPage = i+numPagesAllocated;
+        NachOSpageTable[i].physicalPage = AllocateFrame();
         NachOSpageTable[i].valid = parentPageTable[i].valid;
         NachOSpageTable[i].use = parentPageTable[i].use;
         NachOSpageTable[i].dirty = parentPageTable[i].dirty;
         NachOSpageTable[i].readOnly = parentPageTable[i].readOnly;    // if the code segment was entirely on
                                                                 // a separate page, we could set its
                                                                 // pages to be read-only
+        bcopy(&machine->mainMemory[parentPageTable[i].physicalPage * PageSize],
+              &machine->mainMemory[NachOSpageTable[i].physicalPage * PageSize],
+              PageSize);
+        machine->InvalidateCachedCode(NachOSpageTable[i].physicalPage);
     }
+#endif // VM
+}
 
-    // Copy the contents
-    unsigned startAddrParent = parentPageTable[0].physicalPage*PageSize;
-    unsigned startAddrChild = numPagesAllocated*PageSize;
-    for (i=0; i<size; i++) {
-       machine->mainMemory[startAddrChild+i] = machine->mainMemory[startAddrParent+i];
-    }
+//----------------------------------------------------------------------
+// ProcessAddrSpace::ProcessAddrSpace
+// 	Read back an address space saved by Checkpoint.  Its pages are
+//	already in mainMemory, which is restored separately.
+//
+//	"fd" is the checkpoint file
+//----------------------------------------------------------------------
 
-    numPagesAllocated += numPagesInVM;
+ProcessAddrSpace::ProcessAddrSpace(int fd)
+{
+    Read(fd, (char *)&numPagesInVM, sizeof(numPagesInVM));
+    NachOSpageTable = new TranslationEntry[numPagesInVM];
+    Read(fd, (char *)NachOSpageTable, numPagesInVM * sizeof(TranslationEntry));
+
+    // Its frames are in use again.  (numPagesAllocated is restored with
+    // the other globals, the count of page table entries with the
+    // statistics, and unusedBytes isn't saved.)
+    for (unsigned i = 0; i < numPagesInVM; i++)
+	frameMap->Mark(NachOSpageTable[i].physicalPage);
+    unusedBytes = 0;
+#ifdef VM
+    image = NULL;			// never used: see checkpoint.h
+    backingStore = new BackingStore(numPagesInVM);
+#ifdef USE_TLB
+    asid = nextASID++;
+    tlbHits = tlbMisses = 0;
+#endif
+#endif
 }
 
 //----------------------------------------------------------------------
 // ProcessAddrSpace::~ProcessAddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space, giving its frames back (in the vm
+//	build, those no other address space is sharing).
 //----------------------------------------------------------------------
 
 ProcessAddrSpace::~ProcessAddrSpace()
 {
-   delete NachOSpageTable;
+#ifdef VM
+   TranslationEntry *entry;
+   int frame;
+
+   for (unsigned i = 0; i < numPagesInVM; i++) {
+      if ((entry = GetPageEntry(i)) == NULL)
+	 continue;
+      frame = entry->physicalPage;
+      UnmapPage(i);
+      if (--frameReferences[frame] == 0) {
+	 if (image != NULL)
+	    image->ForgetCodeFrame(i, frame);
+	 FreeFrame(frame);
+      } else
+	 frameTable->Disowned(frame, this);
+   }
+   if (image != NULL)
+      image->RemoveReference();
+   delete backingStore;
+#else
+   for (unsigned i = 0; i < numPagesInVM; i++)
+      FreeFrame(NachOSpageTable[i].physicalPage);
+#endif
+   CountUnusedBytes(-unusedBytes);
+   CountPageTableEntries(-(int) numPagesInVM);
+   delete [] NachOSpageTable;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::CountUnusedBytes
+// 	Keep track of the memory lost to rounding address spaces up to
+//	a whole number of pages.
+//
+//	"change" -- the bytes an address space added, or took away
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::CountUnusedBytes(int change)
+{
+    stats->unusedFrameBytes += change;
+    if (stats->unusedFrameBytes > stats->maxUnusedFrameBytes)
+	stats->maxUnusedFrameBytes = stats->unusedFrameBytes;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::CountPageTableEntries
+// 	Keep track of the memory taken by page tables, which grows as
+//	the page size shrinks.
+//
+//	"change" -- the entries an address space added, or took away
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::CountPageTableEntries(int change)
+{
+#ifndef INVERTED_PAGE_TABLE		// which counts its own entries
+    stats->pageTableEntries += change;
+    if (stats->pageTableEntries > stats->maxPageTableEntries)
+	stats->maxPageTableEntries = stats->pageTableEntries;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -220,26 +427,473 @@ ProcessAddrSpace::InitUserCPURegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, nothing!
+//	For now, nothing!  With a TLB, we count the TLB hits we made
+//	while we ran (the misses are counted as they are handled).
 //----------------------------------------------------------------------
 
 void ProcessAddrSpace::SaveStateOnSwitch() 
-{}
+{
+#ifdef USE_TLB
+    tlbHits += stats->numTLBHits - hitsAtSwitch;
+    hitsAtSwitch = stats->numTLBHits;
+#endif
+}
 
 //----------------------------------------------------------------------
 // ProcessAddrSpace::RestoreStateOnSwitch
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	throw away the simulator's cached translations for the old one.
+//	With a TLB, the machine doesn't see the page table; it just
+//	needs to know whose TLB entries to use.  They can stay in the
+//	TLB from one switch to the next.
 //----------------------------------------------------------------------
 
 void ProcessAddrSpace::RestoreStateOnSwitch() 
 {
+#ifdef USE_TLB
+    machine->currentASID = asid;
+    hitsAtSwitch = stats->numTLBHits;
+#else
     machine->NachOSpageTable = NachOSpageTable;
     machine->NachOSpageTableSize = numPagesInVM;
+#endif
+    machine->FlushHostTLB();
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::Checkpoint
+// 	Save the page table in the checkpoint file "fd".
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::Checkpoint(int fd)
+{
+    WriteFile(fd, (char *)&numPagesInVM, sizeof(numPagesInVM));
+    WriteFile(fd, (char *)NachOSpageTable, numPagesInVM * sizeof(TranslationEntry));
+}
+
+#ifdef VM
+//----------------------------------------------------------------------
+// ProcessAddrSpace::NewFrame
+// 	Take a frame for page "vpn".  The caller has called
+//	FrameTable::MakeRoom, which may wait, and so must check again
+//	afterwards whatever it had found out about our pages before.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::NewFrame(int vpn)
+{
+    int frame;
+
+    frame = AllocateFrame();
+    frameTable->Loaded(frame, this, vpn);
+    frameReferences[frame] = 1;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::InitPageTable
+// 	Set up the page table of a new address space, with every page
+//	out of memory.  With an inverted page table, there is nothing to
+//	do: our pages are added to it as they come into memory.
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::InitPageTable()
+{
+#ifdef INVERTED_PAGE_TABLE
+    NachOSpageTable = NULL;
+#else
+    NachOSpageTable = new TranslationEntry[numPagesInVM];
+    for (unsigned i = 0; i < numPagesInVM; i++) {
+	NachOSpageTable[i].virtualPage = i;
+	NachOSpageTable[i].physicalPage = -1;
+	NachOSpageTable[i].valid = FALSE;
+	NachOSpageTable[i].use = FALSE;
+	NachOSpageTable[i].dirty = FALSE;
+	NachOSpageTable[i].readOnly = FALSE;
+    }
+#endif
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::MapPage, UnmapPage
+// 	Note that page "vpn" is now in "frame", or is no longer in
+//	memory.  MapPage returns the page's entry, which is writable and
+//	hasn't been used; the caller may change that.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+ProcessAddrSpace::MapPage(unsigned vpn, int frame)
+{
+    TranslationEntry *entry;
+
+    ASSERT(vpn < numPagesInVM);
+#ifdef INVERTED_PAGE_TABLE
+    entry = invertedPageTable->Insert(asid, vpn);
+#else
+    entry = &NachOSpageTable[vpn];
+    ASSERT(!entry->valid);
+#endif
+    entry->virtualPage = vpn;
+    entry->physicalPage = frame;
+    entry->valid = TRUE;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+    entry->readOnly = FALSE;
+    return entry;
+}
+
+void
+ProcessAddrSpace::UnmapPage(unsigned vpn)
+{
+#ifdef INVERTED_PAGE_TABLE
+    invertedPageTable->Remove(asid, vpn);
+#else
+    NachOSpageTable[vpn].valid = FALSE;
+    NachOSpageTable[vpn].physicalPage = -1;
+#endif
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::HandlePageFault
+// 	Bring in the page holding "vaddr", which isn't in memory: give
+//	it a frame, and fill the frame in from the backing store if the
+//	page has been written out, or else from the program file.  The
+//	faulting instruction is then simply run again.
+//
+//	A code page is mapped read-only, and if another process running
+//	the same program already has it in memory, we share its frame.
+//
+//	Making room, and reading the page from swap, may mean waiting for
+//	the disk.  The frame is busy meanwhile, so it isn't evicted.
+//
+//	"vaddr" -- the virtual address that caused the fault
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::HandlePageFault(int vaddr)
+{
+    unsigned vpn = (unsigned) vaddr / PageSize;
+    bool isCode;
+    int frame;
+    char *page;
+    unsigned stamp;
+
+    ASSERT(vpn < numPagesInVM);
+    stats->numPageFaults++;
+    isCode = !backingStore->Contains(vpn) && image->IsCode(vpn);
+    if (!isCode || (image->CodeFrame(vpn) == -1))
+	frameTable->MakeRoom();
+    if (isCode && (image->CodeFrame(vpn) != -1)) {
+	frame = image->CodeFrame(vpn);
+	frameReferences[frame]++;
+	stats->numCodeMappingsShared++;
+	DEBUG('a', "Page fault at 0x%x: code page %d shared in frame %d\n",
+	      vaddr, vpn, frame);
+	MapPage(vpn, frame)->readOnly = TRUE;
+	return;
+    }
+
+    frame = NewFrame(vpn);
+    page = &machine->mainMemory[frame * PageSize];
+    DEBUG('a', "Page fault at 0x%x: virtual page %d into frame %d\n",
+	  vaddr, vpn, frame);
+    stamp = frameTable->StartIO(frame);
+    if (backingStore->Contains(vpn))
+	backingStore->Read(vpn, page);
+    else
+	image->ReadPage(vpn, page);
+    frameTable->EndIO(frame, stamp);
+    if (isCode && (image->CodeFrame(vpn) == -1))
+	image->SetCodeFrame(vpn, frame);	// unless another process read
+						// it in while we waited
+    machine->InvalidateCachedCode(frame);
+    MapPage(vpn, frame)->readOnly = isCode;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::CopyOnWrite
+// 	The program has written to a page that it shares with a process
+//	it forked, or that forked it, or to a code page, which it may
+//	share with other processes running the same program.  Give it a
+//	copy of the page in a free frame, which it can write to; the
+//	other processes keep the original.  If no one else is left using
+//	the page, it can simply be made writable again.  The faulting
+//	instruction is then run again.
+//
+//	Making room for the copy may mean waiting, and the page may have
+//	stopped being shared, and even been evicted, by then; if so, the
+//	instruction faults again.
+//
+//	"vaddr" -- the virtual address that caused the fault
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::CopyOnWrite(int vaddr)
+{
+    unsigned vpn = (unsigned) vaddr / PageSize;
+    TranslationEntry *entry;
+    int oldFrame;
+
+    entry = GetPageEntry(vpn);
+    ASSERT((entry != NULL) && entry->readOnly);
+    if (frameReferences[entry->physicalPage] > 1) {
+	frameTable->MakeRoom();
+	if ((entry = GetPageEntry(vpn)) == NULL)
+	    return;
+    }
+    oldFrame = entry->physicalPage;
+
+    if (frameReferences[oldFrame] > 1) {
+	entry->physicalPage = NewFrame(vpn);	// the old frame is shared,
+	frameReferences[oldFrame]--;		// so it can't be evicted
+	frameTable->Disowned(oldFrame, this);
+	stats->numPagesCopied++;
+	DEBUG('a', "Write to shared page %d at 0x%x: copying frame %d to %d\n",
+	      vpn, vaddr, oldFrame, entry->physicalPage);
+	bcopy(&machine->mainMemory[oldFrame * PageSize],
+	      &machine->mainMemory[entry->physicalPage * PageSize], PageSize);
+	machine->InvalidateCachedCode(entry->physicalPage);
+    } else {
+	DEBUG('a', "Write to page %d at 0x%x: no longer shared\n", vpn, vaddr);
+	image->ForgetCodeFrame(vpn, oldFrame);	// it will be changed
+    }
+    entry->readOnly = FALSE;
+    machine->FlushHostTLB();
 }
 
+//----------------------------------------------------------------------
+// ProcessAddrSpace::IsCleanable
+// 	Return TRUE if page "vpn" could be written out along with another
+//	of ours: it is in memory, dirty, not shared, and not being read
+//	or written already.
+//----------------------------------------------------------------------
+
+bool
+ProcessAddrSpace::IsCleanable(unsigned vpn)
+{
+    TranslationEntry *entry = GetPageEntry(vpn);
+
+    return (entry != NULL) && entry->dirty
+	&& (frameReferences[entry->physicalPage] == 1)
+	&& !frameTable->IsBusy(entry->physicalPage);
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::CleanPages
+// 	Write a dirty page out to the backing store, so that it can be
+//	evicted, along with as many of the dirty pages on either side of
+//	it as make up a cluster (see swapspace.h).  Their dirty bits are
+//	cleared first, and their TLB entries dropped, so a page written
+//	to while we wait for the disk is dirty again afterwards.
+//
+//	A page in a frame that we share is written out on its own, and
+//	the other address spaces sharing it are given its slot, and have
+//	their dirty bits cleared too.  None of them can write to it
+//	without copying it first.
+//
+//	We may have been freed by the time the disk is done, if our
+//	process has exited meanwhile, so nothing of ours is touched after
+//	the write.
+//
+//	Returns the number of pages written.
+//
+//	"vpn" -- the page, which is dirty, and the frame table could evict
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::CleanPages(int vpn)
+{
+    int vpns[MaxCluster], frames[MaxCluster];
+    char *pages[MaxCluster];
+    unsigned stamps[MaxCluster];
+    TranslationEntry *entry = GetPageEntry(vpn);
+    ProcessAddrSpace *space;
+    int first = vpn, last = vpn;
+    int count, i;
+
+    ASSERT((entry != NULL) && !frameTable->IsBusy(entry->physicalPage));
+    if (frameReferences[entry->physicalPage] == 1) {
+	while ((last - first + 1 < MaxCluster) && IsCleanable(last + 1))
+	    last++;
+	while ((last - first + 1 < MaxCluster) && (first > 0)
+	       && IsCleanable(first - 1))
+	    first--;
+    }
+    count = last - first + 1;
+    DEBUG('a', "Writing out virtual pages %d to %d\n", first, last);
+    for (i = 0; i < count; i++) {
+	entry = GetPageEntry(first + i);
+	entry->dirty = FALSE;
+	vpns[i] = first + i;
+	frames[i] = entry->physicalPage;
+	pages[i] = &machine->mainMemory[frames[i] * PageSize];
+	stamps[i] = frameTable->StartIO(frames[i]);
+#ifdef USE_TLB
+	machine->InvalidateTLBEntry(asid, first + i);
+#endif
+    }
+    backingStore->Assign(vpns, count);
+    if (frameReferences[frames[0]] > 1)
+	for (i = 0; (space = frameTable->Sharer(frames[0], i)) != NULL; i++)
+	    if (space != this) {
+		space->GetPageEntry(vpn)->dirty = FALSE;
+		space->backingStore->Share(vpn, backingStore);
+	    }
+    machine->FlushHostTLB();		// in case this is the running process
+    backingStore->Write(vpns, pages, count);
+    for (i = 0; i < count; i++)
+	frameTable->EndIO(frames[i], stamps[i]);
+    return count;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::EvictPage
+// 	Take a page out of memory, or at least out of our address space,
+//	and unmap it, so the next access faults it back in.  Its frame is
+//	freed, unless other address spaces share it; the frame table
+//	takes it out of theirs too.  The page must be clean: if it had
+//	changed since it was brought in, CleanPages has written it out.
+//
+//	"vpn" -- the page
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::EvictPage(int vpn)
+{
+    TranslationEntry *entry = GetPageEntry(vpn);
+    int frame;
+
+    ASSERT((entry != NULL) && !entry->dirty);
+    frame = entry->physicalPage;
+    UnmapPage(vpn);
+    if (--frameReferences[frame] == 0) {
+	image->ForgetCodeFrame(vpn, frame);
+	FreeFrame(frame);
+    } else
+	frameTable->Disowned(frame, this);
+    machine->FlushHostTLB();		// in case this is the running process
+#ifdef USE_TLB
+    machine->InvalidateTLBEntry(asid, vpn);
+#endif
+}
+
+#ifdef USE_TLB
+//----------------------------------------------------------------------
+// ProcessAddrSpace::HandleTLBMiss
+// 	The TLB has no entry for the page holding "vaddr".  Bring the
+//	page in if it isn't in memory, and load its entry into the TLB;
+//	the faulting instruction is then run again.
+//
+//	Returns FALSE if "vaddr" is outside the address space, in which
+//	case nothing is done.
+//
+//	"vaddr" -- the virtual address that caused the miss
+//----------------------------------------------------------------------
+
+bool
+ProcessAddrSpace::HandleTLBMiss(int vaddr)
+{
+    unsigned vpn = (unsigned) vaddr / PageSize;
+    TranslationEntry *entry;
+
+    if (vpn >= numPagesInVM)
+	return FALSE;
+    stats->numTLBMisses++;
+    tlbMisses++;
+    if ((entry = GetPageEntry(vpn)) == NULL) {
+	HandlePageFault(vaddr);
+	entry = GetPageEntry(vpn);
+    }
+    LoadTLBEntry(entry);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::LoadTLBEntry
+// 	Load the TLB with a copy of our page table entry "entry", for a
+//	page in memory.  The machine only sets the use and dirty bits in
+//	its copy, so they are set here instead: the page is
+//	noted as used now, and a page that hasn't been written to yet is
+//	loaded read-only, so that the first write traps and can be noted
+//	(see HandleReadOnlyFault).
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::LoadTLBEntry(TranslationEntry *entry)
+{
+    TranslationEntry tlbEntry;
+
+    ASSERT(entry->valid);
+    entry->use = TRUE;
+    tlbEntry = *entry;
+    tlbEntry.readOnly = entry->readOnly || !entry->dirty;
+    machine->LoadTLB(&tlbEntry);
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::HandleReadOnlyFault
+// 	The program has written to a page whose TLB entry is read-only:
+//	either the page is shared copy-on-write, and it needs its own
+//	copy, or this is the first write to it, and it is now dirty.
+//	Load a writable TLB entry for it; the faulting instruction is
+//	then run again.
+//
+//	"vaddr" -- the virtual address that caused the fault
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::HandleReadOnlyFault(int vaddr)
+{
+    unsigned vpn = (unsigned) vaddr / PageSize;
+    TranslationEntry *entry;
+
+    entry = GetPageEntry(vpn);
+    ASSERT(entry != NULL);
+    if (entry->readOnly) {
+	CopyOnWrite(vaddr);		// which may wait, and evict the page
+	if ((entry = GetPageEntry(vpn)) == NULL)
+	    return;
+    }
+    entry->dirty = TRUE;
+    LoadTLBEntry(entry);
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::GetASID
+// 	Return the ID that tags our entries in the TLB.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::GetASID()
+{
+    return asid;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::PrintTLBStats
+// 	Print how often our accesses to memory found their translation
+//	in the TLB, for the process "pid", when it exits.
+//----------------------------------------------------------------------
+
+void
+ProcessAddrSpace::PrintTLBStats(int pid)
+{
+    int lookups;
+
+    SaveStateOnSwitch();		// count the hits up to now
+    lookups = tlbHits + tlbMisses;
+    printf("[pid %d]: TLB hits %d, misses %d, hit rate %d%%\n", pid,
+	   tlbHits, tlbMisses,
+	   (lookups > 0) ? (int) ((100.0 * tlbHits) / lookups) : 0);
+}
+#endif // USE_TLB
+#endif // VM
+
 unsigned
 ProcessAddrSpace::GetNumPages()
 {
@@ -251,3 +905,44 @@ ProcessAddrSpace::GetPageTable()
 {
    return NachOSpageTable;
 }
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::GetPA
+//      Returns the physical address corresponding to the virtual address
+//      "vaddr", like Machine::GetPA, but from our page table, which the
+//      machine doesn't see when it has a TLB.  Returns -1 if "vaddr" is
+//      outside the address space, or its page isn't in memory.
+//----------------------------------------------------------------------
+
+int
+ProcessAddrSpace::GetPA(unsigned vaddr)
+{
+   TranslationEntry *entry = GetPageEntry(vaddr / PageSize);
+
+   if (entry == NULL)
+      return -1;
+   return entry->physicalPage * PageSize + vaddr % PageSize;
+}
+
+//----------------------------------------------------------------------
+// ProcessAddrSpace::GetPageEntry
+//      Returns our page table entry for page "vpn", or NULL if the page
+//      is outside the address space, or isn't in memory.  With an
+//      inverted page table, it is looked up there.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+ProcessAddrSpace::GetPageEntry(unsigned vpn)
+{
+   if (vpn >= numPagesInVM)
+      return NULL;
+#ifdef INVERTED_PAGE_TABLE
+   return invertedPageTable->Lookup(asid, vpn);
+#else
+   stats->numPageTableLookups++;
+   stats->numPageTableProbes++;
+   if (!NachOSpageTable[vpn].valid)
+      return NULL;
+   return &NachOSpageTable[vpn];
+#endif
+}
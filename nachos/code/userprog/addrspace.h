@@ -15,6 +15,10 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#ifdef VM
+#include "image.h"
+#include "backingstore.h"
+#endif
 
 #define UserStackSize		1024 	// increase this as necessary!
 
@@ -26,6 +30,8 @@ class ProcessAddrSpace {
 
     ProcessAddrSpace (ProcessAddrSpace *parentSpace); // Used by fork
 
+    ProcessAddrSpace(int fd);		// Read one back from a checkpoint
+
     ~ProcessAddrSpace();			// De-allocate an address space
 
     void InitUserCPURegisters();		// Initialize user-level CPU registers,
@@ -34,15 +40,67 @@ class ProcessAddrSpace {
     void SaveStateOnSwitch();			// Save/restore address space-specific
     void RestoreStateOnSwitch();		// info on a context switch 
 
+    void Checkpoint(int fd);		// Save the page table in a checkpoint
+
     unsigned GetNumPages();
 
     TranslationEntry* GetPageTable();
+    TranslationEntry *GetPageEntry(unsigned vpn);
+					// Our entry for page "vpn", or NULL
+					// if it isn't in memory
+
+    int GetPA(unsigned vaddr);		// Where "vaddr" is in mainMemory,
+					// or -1 if it isn't in memory
+
+#ifdef VM
+    void HandlePageFault(int vaddr);	// Bring in the page holding "vaddr"
+    void CopyOnWrite(int vaddr);	// Stop sharing the page holding
+					// "vaddr", to write to it
+    int CleanPages(int vpn);		// Write page "vpn" out, and the dirty
+					// pages around it; returns how many
+    void EvictPage(int vpn);		// Take clean page "vpn" out of memory
+					// (or stop sharing it)
+#ifdef USE_TLB
+    bool HandleTLBMiss(int vaddr);	// Load the TLB entry for "vaddr"
+    void HandleReadOnlyFault(int vaddr); // Let the program write to the
+					// page holding "vaddr"
+    int GetASID();			// The ID that tags our TLB entries
+    void PrintTLBStats(int pid);	// Print our TLB hit rate
+#endif
+#endif
 
   private:
     TranslationEntry *NachOSpageTable;	// Assume linear page table translation
-					// for now!
+					// for now!  (NULL with an inverted
+					// page table: see invertedpt.h)
     unsigned int numPagesInVM;		// Number of pages in the virtual 
 					// address space
+    int unusedBytes;			// Bytes of the last page past the
+					// end of the stack
+
+    void CountUnusedBytes(int change);	// Add to the total of unusedBytes
+    void CountPageTableEntries(int change);
+					// and of page table entries
+#ifdef VM
+    ProgramImage *image;		// Where pages not yet touched come from
+    BackingStore *backingStore;		// and where evicted pages go
+
+    int NewFrame(int vpn);		// A free frame to bring page "vpn" into
+    bool IsCleanable(unsigned vpn);	// Could page "vpn" be written out?
+    void InitPageTable();		// Start with no pages in memory
+    TranslationEntry *MapPage(unsigned vpn, int frame);
+					// Page "vpn" is now in "frame"
+    void UnmapPage(unsigned vpn);	// and now it isn't
+#ifdef USE_TLB
+    int asid;				// Address space ID, for the TLB
+    int tlbHits, tlbMisses;		// How often our accesses hit the TLB
+    int hitsAtSwitch;			// stats->numTLBHits when we last
+					// started running
+
+    void LoadTLBEntry(TranslationEntry *entry);
+					// Put our "entry" in the TLB
+#endif
+#endif
 };
 
 #endif // ADDRSPACE_H
@@ -0,0 +1,422 @@
+// checkpoint.cc
+//	Routines to save the state of the simulation in a checkpoint file,
+//	and to restore it.
+//
+//	Each class saves its own state (NachOSThread::Checkpoint,
+//	Machine::Checkpoint, ...); this file saves the kernel's global
+//	variables, and ties the pieces together.  The file is written in
+//	host byte order, so it can only be restored on the same kind of
+//	machine.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "checkpoint.h"
+#include "system.h"
+#include "console.h"
+#include "synch.h"
+#include <map>
+
+// External functions and data used by this file, from exception.cc
+
+extern Console *NewConsole(void);
+extern void WriteOutput(void);
+extern thread_local Semaphore *readAvail, *writeDone;
+
+// The kernel's global variables that are saved; thread_index must be
+// first, as it tells us how much of exitThreadArray follows.  (Each
+// simulation has its own copy of these; see system.h.)
+
+static thread_local int *globals[] = { (int *)&thread_index, (int *)&numPagesAllocated,
+			  &scheduler_type, &process_start_time,
+			  &system_start_time, &total_burst, &total_max_burst,
+			  &total_min_burst, &total_burst_count,
+			  &total_ready_queue_waittime, &total_thread_time,
+			  &total_max_thread_time, &total_min_thread_time,
+			  &thread_count, &quantum };
+#define NumGlobals	(int)(sizeof(globals) / sizeof(int *))
+
+// A pending interrupt, as saved in the checkpoint.  Each console
+// always has a poll pending, so the pending interrupts also tell us
+// which consoles there are.
+
+struct SavedInterrupt {
+    int type;			// an IntType
+    int when;			// when it will happen
+    int console;		// which console it is for, numbered in order
+				// of first appearance (-1 for the timer)
+    int incoming;		// the character that console has buffered
+};
+
+// What a thread part way through a Print call still has to write
+// (see PendingOutput in thread.h), as saved in the checkpoint.
+
+struct SavedOutput {
+    int console;		// numbered as in SavedInterrupt
+    char chars[MaxOutputChars];
+    int next, count;
+    int stringAddr;
+};
+
+static thread_local int checkpointFd;		// where SavePending writes
+static thread_local std::map<Console *, int> *consoleNumber;
+						// ... and its numbering
+static thread_local int numPending;		// counted by CountPending
+
+//----------------------------------------------------------------------
+// CountPending
+// 	Count one pending interrupt.
+//----------------------------------------------------------------------
+
+static void
+CountPending(intptr_t arg)
+{
+    numPending++;
+}
+
+//----------------------------------------------------------------------
+// SavePending
+// 	Write one pending interrupt to the checkpoint.
+//----------------------------------------------------------------------
+
+static void
+SavePending(intptr_t arg)
+{
+    PendingInterrupt *pending = (PendingInterrupt *)arg;
+    SavedInterrupt saved;
+    Console *console;
+
+    saved.type = pending->type;
+    saved.when = pending->when;
+    saved.console = -1;
+    saved.incoming = EOF;
+    if ((pending->type == ConsoleReadInt)
+		|| (pending->type == ConsoleWriteInt)) {
+	console = (Console *)pending->arg;
+	if (consoleNumber->find(console) == consoleNumber->end()) {
+	    int n = consoleNumber->size();
+	    (*consoleNumber)[console] = n;
+	}
+	saved.console = (*consoleNumber)[console];
+	saved.incoming = console->PeekChar();
+    } else
+	ASSERT(pending->type == TimerInt);	// disks and networks
+						// aren't saved
+    WriteFile(checkpointFd, (char *)&saved, sizeof(saved));
+}
+
+//----------------------------------------------------------------------
+// SaveThread
+// 	Write a thread that isn't running to the checkpoint, with what it
+//	still has to print, if it is waiting for the console.
+//----------------------------------------------------------------------
+
+static void
+SaveThread(int fd, NachOSThread *thread)
+{
+    SavedOutput saved;
+
+    thread->Checkpoint(fd);
+    memset(&saved, 0, sizeof(saved));
+    saved.console = -1;
+    if (thread->resumePoint == ResumeInPrint) {
+	ASSERT(consoleNumber->find(thread->output.console)
+			!= consoleNumber->end());
+	saved.console = (*consoleNumber)[thread->output.console];
+	memcpy(saved.chars, thread->output.chars, MaxOutputChars);
+	saved.next = thread->output.next;
+	saved.count = thread->output.count;
+	saved.stringAddr = thread->output.stringAddr;
+    }
+    WriteFile(fd, (char *)&saved, sizeof(saved));
+}
+
+//----------------------------------------------------------------------
+// TakeCheckpoint
+// 	Save the state of the simulation in "fileName".  Called by
+//	Machine::Run between two instructions of the current thread.
+//
+//	Returns FALSE, without saving anything, if some other thread is
+//	stopped in the kernel where it couldn't be restarted; the caller
+//	should try again later.
+//----------------------------------------------------------------------
+
+bool
+TakeCheckpoint(char *fileName)
+{
+    int header[4] = { CKPTMAGIC, PageSize, NumPhysPages, NumTotalRegs };
+    int values[NumGlobals + 1];
+    int fd, i, count;
+    NachOSThread *thread;
+    TimeSortedWaitQueue *sleeper;
+
+    count = 0;
+    for (i = 0; i < (int)thread_index; i++) {
+	thread = threadArray[i];
+	if (exitThreadArray[i] || (thread == currentThread))
+	    continue;
+#ifdef VM
+	if (thread == pageCleaner)
+	    continue;			// a vm checkpoint is never restored
+#endif
+	if (thread->resumePoint == ResumeInKernel)
+	    return FALSE;
+	count++;
+    }
+
+    DEBUG('t', "Saving checkpoint %s at time %d\n", fileName,
+	  stats->totalTicks);
+    fd = OpenForWrite(fileName);
+    WriteFile(fd, (char *)header, sizeof(header));
+
+    for (i = 0; i < NumGlobals; i++)
+	values[i] = *globals[i];
+    values[i] = initializedConsoleSemaphores;
+    WriteFile(fd, (char *)values, sizeof(values));
+    WriteFile(fd, (char *)exitThreadArray, thread_index * sizeof(bool));
+    WriteFile(fd, (char *)stats, sizeof(Statistics));
+    machine->Checkpoint(fd);
+
+    numPending = 0;
+    interrupt->ForEachPending(CountPending);
+    WriteFile(fd, (char *)&numPending, sizeof(int));
+    checkpointFd = fd;
+    consoleNumber = new std::map<Console *, int>;
+    interrupt->ForEachPending(SavePending);
+
+    // the running thread first, then the rest
+    WriteFile(fd, (char *)&count, sizeof(int));
+    currentThread->Checkpoint(fd);
+    for (i = 0; i < (int)thread_index; i++)
+	if (!exitThreadArray[i] && (threadArray[i] != currentThread)
+#ifdef VM
+	    && (threadArray[i] != pageCleaner)
+#endif
+	    )
+	    SaveThread(fd, threadArray[i]);
+    delete consoleNumber;
+    scheduler->Checkpoint(fd);
+    if (initializedConsoleSemaphores) {
+	readAvail->Checkpoint(fd);
+	writeDone->Checkpoint(fd);
+    }
+
+    count = 0;
+    for (sleeper = sleepQueueHead; sleeper != NULL; sleeper = sleeper->GetNext())
+	count++;
+    WriteFile(fd, (char *)&count, sizeof(int));
+    for (sleeper = sleepQueueHead; sleeper != NULL; sleeper = sleeper->GetNext()) {
+	int entry[2] = { sleeper->GetThread()->GetPID(), (int)sleeper->GetWhen() };
+	WriteFile(fd, (char *)entry, sizeof(entry));
+    }
+
+    Close(fd);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AdvancePC
+// 	Step over the system call instruction, as ExceptionHandler does
+//	before returning.
+//----------------------------------------------------------------------
+
+static void
+AdvancePC()
+{
+    machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
+    machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
+    machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
+}
+
+//----------------------------------------------------------------------
+// ResumeThread
+// 	The first thing a restored thread runs, when it is scheduled.  It
+//	finishes whatever the thread was in the middle of when the
+//	checkpoint was taken, and goes back to running its user program.
+//
+//	The thread starts with interrupts off (see ResumeThreadStack), and
+//	turns them back on at the same point as the original would have,
+//	so the simulated time comes out the same.
+//----------------------------------------------------------------------
+
+static void
+ResumeThread(intptr_t dummy)
+{
+    int result;
+
+    currentThread->Startup();
+    switch (currentThread->resumePoint) {
+      case ResumeInJoin:
+	result = currentThread->FinishJoin();
+	interrupt->Enable();
+	machine->WriteRegister(2, result);
+	break;
+      case ResumeInPrint:
+	writeDone->P();			// interrupts are still off, so this
+	interrupt->Enable();		// is what's left of the original P()
+	currentThread->resumePoint = ResumeInKernel;
+	currentThread->output.console->PutChar(
+	    currentThread->output.chars[currentThread->output.next++]);
+	WriteOutput();
+	break;
+      case ResumeAfterSyscall:
+	interrupt->Enable();
+	break;
+      default:
+	interrupt->Enable();
+	machine->Run();
+    }
+    AdvancePC();
+    currentThread->resumePoint = ResumeInUser;
+    machine->ResumeAfterTrap();
+}
+
+//----------------------------------------------------------------------
+// RestoreThread
+// 	Read back a thread saved by SaveThread, into a new NachOSThread.
+//----------------------------------------------------------------------
+
+static NachOSThread *
+RestoreThread(int fd, Console **consoles)
+{
+    NachOSThread *thread = new NachOSThread("restored");
+    SavedOutput saved;
+
+    thread->Restore(fd);
+    Read(fd, (char *)&saved, sizeof(saved));
+    if (saved.console != -1) {
+	thread->output.console = consoles[saved.console];
+	memcpy(thread->output.chars, saved.chars, MaxOutputChars);
+	thread->output.next = saved.next;
+	thread->output.count = saved.count;
+	thread->output.stringAddr = saved.stringAddr;
+    }
+    thread->ResumeThreadStack(ResumeThread, 0);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// RestoreCheckpoint
+// 	Start again from the checkpoint saved in "fileName".  Called by
+//	main in place of loading any programs.
+//
+//	The thread that was running when the checkpoint was taken carries
+//	on in the main thread, much as StartUserProcess runs a program in
+//	it; the others get new threads, which start in ResumeThread.
+//----------------------------------------------------------------------
+
+void
+RestoreCheckpoint(char *fileName)
+{
+    int header[4];
+    int values[NumGlobals + 1];
+    int fd, i, count, numConsoles;
+    NachOSThread *thread, *running;
+    NachOSThread **restored;
+    TimeSortedWaitQueue *sleeper, *lastSleeper;
+    SavedInterrupt *saved;
+    Console **consoles;
+
+#ifdef VM
+    printf("Can't restore a checkpoint in the vm build\n");
+    return;
+#endif
+    fd = OpenForReadWrite(fileName, FALSE);
+    if (fd < 0) {
+	printf("Unable to open checkpoint %s\n", fileName);
+	return;
+    }
+    Read(fd, (char *)header, sizeof(header));
+    if ((header[0] != CKPTMAGIC) || (header[1] != PageSize)
+		|| (header[2] != NumPhysPages) || (header[3] != NumTotalRegs)) {
+	printf("%s is not a checkpoint of this machine\n", fileName);
+	Close(fd);
+	return;
+    }
+
+    Read(fd, (char *)values, sizeof(values));
+    for (i = 0; i < NumGlobals; i++)
+	*globals[i] = values[i];
+    initializedConsoleSemaphores = values[i];
+    Read(fd, (char *)exitThreadArray, thread_index * sizeof(bool));
+    Read(fd, (char *)stats, sizeof(Statistics));
+    machine->Restore(fd);
+
+    // Opening the consoles schedules their first polls; throw those
+    // away, with the timer's, and put back the ones that were pending.
+    Read(fd, (char *)&count, sizeof(int));
+    saved = new SavedInterrupt[count];
+    Read(fd, (char *)saved, count * sizeof(SavedInterrupt));
+    numConsoles = 0;
+    for (i = 0; i < count; i++)
+	if (saved[i].console >= numConsoles)
+	    numConsoles = saved[i].console + 1;
+
+    consoles = new Console *[numConsoles];
+    for (i = 0; i < numConsoles; i++)
+	consoles[i] = NewConsole();
+    interrupt->CancelPending();
+    for (i = 0; i < count; i++) {
+	if (saved[i].type == TimerInt)
+	    timer->ResumeInterrupt(saved[i].when);
+	else {
+	    consoles[saved[i].console]->ResumeInterrupt((IntType)saved[i].type,
+							saved[i].when);
+	    consoles[saved[i].console]->UngetChar(saved[i].incoming);
+	}
+    }
+    delete [] saved;
+
+    // The running thread takes over this one.  The others are created
+    // with currentThread NULL, so they aren't registered as our
+    // children; their real parents are restored with them.  Creating
+    // them hands out new pids, so put back the saved thread_index.
+    Read(fd, (char *)&count, sizeof(int));
+    running = currentThread;
+    running->Restore(fd);
+    restored = new NachOSThread *[count];
+    currentThread = NULL;
+    for (i = 0; i < count; i++)
+	restored[i] = RestoreThread(fd, consoles);
+    currentThread = running;
+    thread_index = values[0];
+    delete [] consoles;
+    for (i = 0; i < MAX_THREAD_COUNT; i++)
+	threadArray[i] = NULL;
+    threadArray[running->GetPID()] = running;
+    for (i = 0; i < count; i++)
+	threadArray[restored[i]->GetPID()] = restored[i];
+    delete [] restored;
+    scheduler->Restore(fd);
+    if (initializedConsoleSemaphores) {
+	readAvail = new Semaphore("read avail", 0);
+	writeDone = new Semaphore("write done", 1);
+	readAvail->Restore(fd);
+	writeDone->Restore(fd);
+    }
+
+    Read(fd, (char *)&count, sizeof(int));
+    lastSleeper = NULL;
+    for (i = 0; i < count; i++) {
+	int entry[2];
+
+	Read(fd, (char *)entry, sizeof(entry));
+	thread = threadArray[entry[0]];
+	ASSERT(thread != NULL);
+	sleeper = new TimeSortedWaitQueue(thread, entry[1]);
+	if (lastSleeper == NULL)
+	    sleepQueueHead = sleeper;
+	else
+	    lastSleeper->SetNext(sleeper);
+	lastSleeper = sleeper;
+    }
+    Close(fd);
+
+    DEBUG('t', "Restored checkpoint %s at time %d\n", fileName,
+	  stats->totalTicks);
+    running->space->RestoreStateOnSwitch();	// load page table register
+    machine->Run();			// carry on where we left off
+    ASSERT(FALSE);			// machine->Run never returns
+}
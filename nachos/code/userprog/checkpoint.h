@@ -0,0 +1,47 @@
+// checkpoint.h
+//	Routines to save the whole state of the simulation in a file, and
+//	to start again from it later.
+//
+//	With -ckpt <file> <ticks>, Nachos saves a checkpoint at the first
+//	point after simulated time <ticks> at which it is safe to do so,
+//	and carries on running.  With -restore <file>, it starts from the
+//	checkpoint instead of loading programs: main memory, the CPU and
+//	cache state, every thread and its page table, the ready list, the
+//	sleep queue, the pending interrupts, and the statistics are all
+//	put back as they were, so the run continues exactly as the
+//	original did.  Many experiments can be started from one warmed-up
+//	state this way.
+//
+//	Thread stacks can't be saved, so a checkpoint is only taken while
+//	the running thread is between two user instructions, and every
+//	other thread is either in user code, waiting for the console in
+//	a Print call, or just about to return from Yield, Sleep or Join
+//	(see ResumePoint in thread.h).  Any other thread in the kernel
+//	holds up the checkpoint until it leaves.
+//
+//	The restoring Nachos must be given the same -ic, -dc and -cost
+//	flags as the one that took the checkpoint, and the same -ps and
+//	-mem (which are checked).
+//
+//	The vm build can't take or restore checkpoints: its address spaces
+//	page from their program files, which aren't saved.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "copyright.h"
+
+#define CKPTMAGIC 0xc4ec4e	// first word of a checkpoint file
+
+extern bool TakeCheckpoint(char *fileName);	// save a checkpoint in
+						// "fileName"; FALSE if
+						// it isn't safe yet
+extern void RestoreCheckpoint(char *fileName);	// start from the checkpoint
+						// in "fileName"; only
+						// returns if it can't
+
+#endif // CHECKPOINT_H
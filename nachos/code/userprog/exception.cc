@@ -49,39 +49,165 @@
 //	"which" is the kind of exception.  The list of possible exceptions 
 //	are in machine.h.
 //----------------------------------------------------------------------
-static Semaphore *readAvail;
-static Semaphore *writeDone;
-static void ReadAvail(int arg) { readAvail->V(); }
-static void WriteDone(int arg) { writeDone->V(); }
+thread_local Semaphore *readAvail;	// not static, so that checkpoints
+thread_local Semaphore *writeDone;	// can save them
+static void ReadAvail(intptr_t arg) { readAvail->V(); }
+static void WriteDone(intptr_t arg) { writeDone->V(); }
+
+//----------------------------------------------------------------------
+// NewConsole
+//      Open the console the system calls print on.  Every trap opens a
+//      new one; restoring a checkpoint opens them all again.
+//----------------------------------------------------------------------
+
+Console *
+NewConsole (void)
+{
+   return new Console(NULL, NULL, ReadAvail, WriteDone, 0);
+}
 
 extern void StartUserProcess (char*);
 
+//----------------------------------------------------------------------
+// ReadUserByte
+//      Read the byte at "vaddr" in the current user program's memory,
+//      for a system call, into "*value".  In the vm build the page may
+//      not have been touched yet; it is brought in here, rather than
+//      letting ReadMem trap, since we are already in the kernel.  For
+//      the same reason, with a TLB the byte is found through the page
+//      table, not the TLB.
+//----------------------------------------------------------------------
+
+static void
+ReadUserByte (int vaddr, int *value)
+{
+#ifdef VM
+   ProcessAddrSpace *space = currentThread->space;
+
+   if ((space->GetPA(vaddr) == -1)
+		&& ((unsigned) vaddr / PageSize < space->GetNumPages()))
+      space->HandlePageFault(vaddr);
+#endif
+#ifdef USE_TLB
+   ASSERT(space->GetPA(vaddr) != -1);	// ReadMem would fail on this too
+   *value = machine->mainMemory[space->GetPA(vaddr)];
+#else
+   machine->ReadMem(vaddr, 1, value);
+#endif
+}
+
 void
-ForkStartFunction (int dummy)
+ForkStartFunction (intptr_t dummy)
 {
    currentThread->Startup();
    machine->Run();
 }
 
-static void ConvertIntToHex (unsigned v, Console *console)
+//----------------------------------------------------------------------
+// StartOutput, AddOutputChar
+//      Set up what a Print system call is going to write on "console",
+//      in currentThread->output, one character at a time.
+//----------------------------------------------------------------------
+
+static void
+StartOutput (Console *console)
+{
+   currentThread->output.console = console;
+   currentThread->output.next = 0;
+   currentThread->output.count = 0;
+   currentThread->output.stringAddr = -1;
+}
+
+static void
+AddOutputChar (char c)
+{
+   ASSERT(currentThread->output.count < MaxOutputChars);
+   currentThread->output.chars[currentThread->output.count++] = c;
+}
+
+//----------------------------------------------------------------------
+// WriteOutput
+//      Write out currentThread->output, waiting for the console to
+//      finish each character before starting the next, then read and
+//      write the rest of the string it ends in, if any.  The string is
+//      read a character at a time, as it is written.
+//
+//      While it waits the thread can be saved in a checkpoint; the
+//      output is all there, so it can be restarted.
+//----------------------------------------------------------------------
+
+void
+WriteOutput (void)
+{
+   PendingOutput *output = &currentThread->output;
+   int memval;
+
+   for (;;) {
+      while (output->next < output->count) {
+         currentThread->resumePoint = ResumeInPrint;
+         writeDone->P() ;
+         currentThread->resumePoint = ResumeInKernel;
+         output->console->PutChar(output->chars[output->next++]);
+      }
+      if (output->stringAddr == -1)
+         return;
+      output->stringAddr++;
+      ReadUserByte(output->stringAddr, &memval);
+      if ((*(char*)&memval) == '\0')
+         return;
+      output->next = 0;
+      output->count = 0;
+      AddOutputChar(*(char*)&memval);
+   }
+}
+
+static void ConvertIntToHex (unsigned v)
 {
    unsigned x;
    if (v == 0) return;
-   ConvertIntToHex (v/16, console);
+   ConvertIntToHex (v/16);
    x = v % 16;
    if (x < 10) {
-      writeDone->P() ;
-      console->PutChar('0'+x);
+      AddOutputChar('0'+x);
    }
    else {
-      writeDone->P() ;
-      console->PutChar('a'+x-10);
+      AddOutputChar('a'+x-10);
    }
 }
 
 void
 ExceptionHandler(ExceptionType which)
 {
+#ifdef VM
+#ifdef USE_TLB
+    // A page with no TLB entry; load one (bringing the page in if need
+    // be), and let the instruction run again.  This isn't a system
+    // call, so none of what follows applies, unless the address is
+    // outside the address space altogether.
+    if ((which == PageFaultException)
+	&& currentThread->space->HandleTLBMiss(machine->ReadRegister(BadVAddrReg)))
+       return;
+    // Likewise a write to a page shared with a parent or child, or the
+    // first write to a page.
+    if (which == ReadOnlyException) {
+       currentThread->space->HandleReadOnlyFault(machine->ReadRegister(BadVAddrReg));
+       return;
+    }
+#else
+    // A page the program hasn't touched before; bring it in, and let
+    // the instruction run again.  This isn't a system call, so none of
+    // what follows applies.
+    if (which == PageFaultException) {
+       currentThread->space->HandlePageFault(machine->ReadRegister(BadVAddrReg));
+       return;
+    }
+    // Likewise a write to a page shared with a parent or child.
+    if (which == ReadOnlyException) {
+       currentThread->space->CopyOnWrite(machine->ReadRegister(BadVAddrReg));
+       return;
+    }
+#endif
+#endif
     int type = machine->ReadRegister(2);
     int memval, vaddr, printval, tempval, exp;
     unsigned printvalus;        // Used for printing in hex
@@ -90,7 +216,7 @@ ExceptionHandler(ExceptionType which)
        writeDone = new Semaphore("write done", 1);
        initializedConsoleSemaphores = true;
     }
-    Console *console = new Console(NULL, NULL, ReadAvail, WriteDone, 0);;
+    Console *console = NewConsole();
     int exitcode;               // Used in SYScall_Exit
     unsigned i;
     char buffer[1024];          // Used in SYScall_Exec
@@ -99,20 +225,34 @@ ExceptionHandler(ExceptionType which)
     NachOSThread *child;              // Used by SYScall_Fork
     unsigned sleeptime;         // Used by SYScall_Sleep
 
+    currentThread->resumePoint = ResumeInKernel;
+    if ((which == SyscallException) && (eventTrace != NULL))
+	eventTrace->Record(TraceSyscall, currentThread->GetPID(), type);
     if ((which == SyscallException) && (type == SYScall_Halt)) {
 	DEBUG('a', "Shutdown, initiated by user program.\n");
+#ifdef USE_TLB
+	if (currentThread->space != NULL)
+	   currentThread->space->PrintTLBStats(currentThread->GetPID());
+#endif
    	interrupt->Halt();
     }
     else if ((which == SyscallException) && (type == SYScall_Exit)) {
        exitcode = machine->ReadRegister(4);
        printf("[pid %d]: Exit called. Code: %d\n", currentThread->GetPID(), exitcode);
+#ifdef USE_TLB
+       currentThread->space->PrintTLBStats(currentThread->GetPID());
+#endif
        // We do not wait for the children to finish.
        // The children will continue to run.
        // We will worry about this when and if we implement signals.
        exitThreadArray[currentThread->GetPID()] = true;
 
-       // Find out if all threads have called exit
+       // Find out if all threads have called exit (the vm build's page
+       // cleaner never does)
        for (i=0; i<thread_index; i++) {
+#ifdef VM
+          if (threadArray[i] == pageCleaner) continue;
+#endif
           if (!exitThreadArray[i]) break;
        }
        currentThread->Exit(i==thread_index, exitcode);
@@ -120,13 +260,13 @@ ExceptionHandler(ExceptionType which)
     else if ((which == SyscallException) && (type == SYScall_Exec)) {
        // Copy the executable name into kernel space
        vaddr = machine->ReadRegister(4);
-       machine->ReadMem(vaddr, 1, &memval);
+       ReadUserByte(vaddr, &memval);
        i = 0;
        while ((*(char*)&memval) != '\0') {
           buffer[i] = (*(char*)&memval);
           i++;
           vaddr++;
-          machine->ReadMem(vaddr, 1, &memval);
+          ReadUserByte(vaddr, &memval);
        }
        buffer[i] = (*(char*)&memval);
        StartUserProcess(buffer);
@@ -144,7 +284,9 @@ ExceptionHandler(ExceptionType which)
           machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
        }
        else {
+          currentThread->resumePoint = ResumeInJoin;
           exitcode = currentThread->JoinWithChild (whichChild);
+          currentThread->resumePoint = ResumeInKernel;
           machine->WriteRegister(2, exitcode);
           // Advance program counters.
           machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
@@ -170,14 +312,19 @@ ExceptionHandler(ExceptionType which)
 
        child = new NachOSThread("Forked thread");
        child->space = new ProcessAddrSpace (currentThread->space);  // Duplicates the address space
+       if (profiler != NULL)
+          profiler->Fork(currentThread->GetPID(), child->GetPID());
        child->SaveUserState ();                               // Duplicate the register set
        child->ResetReturnValue ();                           // Sets the return register to zero
+       child->resumePoint = ResumeInUser;                    // Starts in Machine::Run
        child->AllocateThreadStack (ForkStartFunction, 0);     // Make it ready for a later context switch
        child->Schedule ();
        machine->WriteRegister(2, child->GetPID());              // Return value for parent
     }
     else if ((which == SyscallException) && (type == SYScall_Yield)) {
+       currentThread->resumePoint = ResumeAfterSyscall;
        currentThread->YieldCPU();
+       currentThread->resumePoint = ResumeInKernel;
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
@@ -185,14 +332,13 @@ ExceptionHandler(ExceptionType which)
     }
     else if ((which == SyscallException) && (type == SYScall_PrintInt)) {
        printval = machine->ReadRegister(4);
+       StartOutput(console);
        if (printval == 0) {
-	  writeDone->P() ;
-          console->PutChar('0');
+          AddOutputChar('0');
        }
        else {
           if (printval < 0) {
-	     writeDone->P() ;
-             console->PutChar('-');
+             AddOutputChar('-');
              printval = -printval;
           }
           tempval = printval;
@@ -203,20 +349,21 @@ ExceptionHandler(ExceptionType which)
           }
           exp = exp/10;
           while (exp > 0) {
-	     writeDone->P() ;
-             console->PutChar('0'+(printval/exp));
+             AddOutputChar('0'+(printval/exp));
              printval = printval % exp;
              exp = exp/10;
           }
        }
+       WriteOutput();
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
        machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg)+4);
     }
     else if ((which == SyscallException) && (type == SYScall_PrintChar)) {
-	writeDone->P() ;
-        console->PutChar(machine->ReadRegister(4));   // echo it!
+       StartOutput(console);
+       AddOutputChar(machine->ReadRegister(4));   // echo it!
+       WriteOutput();
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
@@ -224,12 +371,12 @@ ExceptionHandler(ExceptionType which)
     }
     else if ((which == SyscallException) && (type == SYScall_PrintString)) {
        vaddr = machine->ReadRegister(4);
-       machine->ReadMem(vaddr, 1, &memval);
-       while ((*(char*)&memval) != '\0') {
-	  writeDone->P() ;
-          console->PutChar(*(char*)&memval);
-          vaddr++;
-          machine->ReadMem(vaddr, 1, &memval);
+       ReadUserByte(vaddr, &memval);
+       if ((*(char*)&memval) != '\0') {
+          StartOutput(console);
+          AddOutputChar(*(char*)&memval);
+          currentThread->output.stringAddr = vaddr;
+          WriteOutput();
        }
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
@@ -245,7 +392,7 @@ ExceptionHandler(ExceptionType which)
     }
     else if ((which == SyscallException) && (type == SYScall_GetPA)) {
        vaddr = machine->ReadRegister(4);
-       machine->WriteRegister(2, machine->GetPA(vaddr));  // Return value
+       machine->WriteRegister(2, currentThread->space->GetPA(vaddr));  // Return value
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
@@ -267,6 +414,7 @@ ExceptionHandler(ExceptionType which)
     }
     else if ((which == SyscallException) && (type == SYScall_Sleep)) {
        sleeptime = machine->ReadRegister(4);
+       currentThread->resumePoint = ResumeAfterSyscall;
        if (sleeptime == 0) {
           // emulate a yield
           currentThread->YieldCPU();
@@ -274,6 +422,7 @@ ExceptionHandler(ExceptionType which)
        else {
           currentThread->SortedInsertInWaitQueue (sleeptime+stats->totalTicks);
        }
+       currentThread->resumePoint = ResumeInKernel;
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
@@ -288,17 +437,16 @@ ExceptionHandler(ExceptionType which)
     }
     else if ((which == SyscallException) && (type == SYScall_PrintIntHex)) {
        printvalus = (unsigned)machine->ReadRegister(4);
-       writeDone->P() ;
-       console->PutChar('0');
-       writeDone->P() ;
-       console->PutChar('x');
+       StartOutput(console);
+       AddOutputChar('0');
+       AddOutputChar('x');
        if (printvalus == 0) {
-          writeDone->P() ;
-          console->PutChar('0');
+          AddOutputChar('0');
        }
        else {
-          ConvertIntToHex (printvalus, console);
+          ConvertIntToHex (printvalus);
        }
+       WriteOutput();
        // Advance program counters.
        machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
        machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
@@ -314,4 +462,5 @@ ExceptionHandler(ExceptionType which)
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
     }
+    currentThread->resumePoint = ResumeInUser;
 }
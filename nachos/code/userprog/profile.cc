@@ -0,0 +1,424 @@
+// profile.cc
+//	Routines to sample the PC of user programs, and to report the
+//	samples by function.
+//
+//	We only know about external (global) functions: code in a
+//	static function is charged to the function before it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "profile.h"
+#include "system.h"
+#include "coff.h"
+
+// The MIPS symbol table, as described in <syms.h> on a MIPS machine
+// (bin/out.c uses that header; we only need a few fields of it).
+// The file header's f_symptr points to the symbolic header.
+
+struct SymbolicHeader {
+    short magic;
+    short vstamp;
+    int ilineMax, cbLine, cbLineOffset, idnMax, cbDnOffset;
+    int ipdMax, cbPdOffset, isymMax, cbSymOffset, ioptMax, cbOptOffset;
+    int iauxMax, cbAuxOffset, issMax, cbSsOffset;
+    int issExtMax;		// size of the external string table
+    int cbSsExtOffset;		// ... and where it is
+    int ifdMax, cbFdOffset, crfd, cbRfdOffset;
+    int iextMax;		// # of external symbols
+    int cbExtOffset;		// ... and where they are
+};
+
+struct ExternalSymbol {
+    short flags;
+    short ifd;
+    int iss;			// offset of the name in the string table
+    int value;			// for a procedure, its address
+    unsigned int bits;		// st:6, sc:5, reserved:1, index:20
+};
+
+#define SymbolType(bits)	((bits) & 0x3f)
+#define StorageClass(bits)	(((bits) >> 6) & 0x1f)
+#define stProc		6	// symbol type of a procedure
+#define scText		1	// storage class of code
+
+//----------------------------------------------------------------------
+// ReadAt
+// 	Read "size" bytes at "position" in the UNIX file "fd".  Returns
+//	FALSE if the file is too short.
+//----------------------------------------------------------------------
+
+static bool
+ReadAt(int fd, void *into, int size, int position)
+{
+    Lseek(fd, position, 0);
+    return (ReadPartial(fd, (char *) into, size) == size);
+}
+
+//----------------------------------------------------------------------
+// SymbolTable::SymbolTable
+// 	Read the functions of a user program from its .coff file, and
+//	sort them by address.  If there is no .coff file, or it doesn't
+//	make sense, every sample ends up in "unknown code".
+//
+//	"program" -- the name of the NOFF executable; the symbols are in
+//		"program".coff
+//----------------------------------------------------------------------
+
+SymbolTable::SymbolTable(char *programName)
+{
+    char *coffName = new char[strlen(programName) + 6];
+    struct filehdr fileHeader;
+    SymbolicHeader header;
+    ExternalSymbol *symbols = NULL;
+    int fd, i, j;
+
+    program = new char[strlen(programName) + 1];
+    strcpy(program, programName);
+    numSymbols = 0;
+    address = NULL;
+    name = NULL;
+    strings = NULL;
+    next = NULL;
+
+    sprintf(coffName, "%s.coff", programName);
+    fd = OpenForReadWrite(coffName, FALSE);
+    delete [] coffName;
+    if (fd < 0)
+	return;
+
+    if (!ReadAt(fd, &fileHeader, sizeof(fileHeader), 0)
+	    || (ShortToHost(fileHeader.f_magic) != MIPSELMAGIC)
+	    || !ReadAt(fd, &header, sizeof(header),
+			WordToHost(fileHeader.f_symptr))) {
+	Close(fd);
+	return;
+    }
+    int numExternals = WordToHost(header.iextMax);
+    int stringSize = WordToHost(header.issExtMax);
+    if ((numExternals < 0) || (stringSize < 0)) {
+	Close(fd);
+	return;
+    }
+
+    symbols = new ExternalSymbol[numExternals];
+    strings = new char[stringSize + 1];
+    if (!ReadAt(fd, symbols, numExternals * sizeof(ExternalSymbol),
+		WordToHost(header.cbExtOffset))
+	    || !ReadAt(fd, strings, stringSize,
+			WordToHost(header.cbSsExtOffset))) {
+	numExternals = 0;
+    }
+    strings[stringSize] = '\0';
+    Close(fd);
+
+    // Keep the procedures, in order of address (insertion sort: there
+    // are only a few dozen of them).
+    address = new int[numExternals];
+    name = new char *[numExternals];
+    for (i = 0; i < numExternals; i++) {
+	unsigned int bits = WordToHost(symbols[i].bits);
+	int iss = WordToHost(symbols[i].iss);
+	int value = WordToHost(symbols[i].value);
+
+	if ((SymbolType(bits) != stProc) || (StorageClass(bits) != scText)
+		|| (iss < 0) || (iss >= stringSize))
+	    continue;
+	for (j = numSymbols; (j > 0) && (address[j - 1] > value); j--) {
+	    address[j] = address[j - 1];
+	    name[j] = name[j - 1];
+	}
+	address[j] = value;
+	name[j] = &strings[iss];
+	numSymbols++;
+    }
+    delete [] symbols;
+}
+
+SymbolTable::~SymbolTable()
+{
+    delete [] program;
+    delete [] address;
+    delete [] name;
+    delete [] strings;
+}
+
+//----------------------------------------------------------------------
+// SymbolTable::Find
+// 	Return the index of the function containing "addr", or numSymbols
+//	if it comes before the first function.
+//
+//	Programs stay in one function for a long time, so we first check
+//	"hint", the answer we gave last time.
+//----------------------------------------------------------------------
+
+int
+SymbolTable::Find(int addr, int hint)
+{
+    if ((hint < numSymbols) && (address[hint] <= addr)
+	    && ((hint + 1 == numSymbols) || (addr < address[hint + 1])))
+	return hint;
+
+    int lo = 0, hi = numSymbols;	// answer is in [lo - 1, hi)
+    while (lo < hi) {
+	int mid = (lo + hi) / 2;
+	if (address[mid] <= addr)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return (lo == 0) ? numSymbols : lo - 1;
+}
+
+//----------------------------------------------------------------------
+// ProcessProfile::ProcessProfile
+// 	Start counting samples for process "pid", running the program
+//	described by "symbols".
+//----------------------------------------------------------------------
+
+ProcessProfile::ProcessProfile(int processId, SymbolTable *programSymbols)
+{
+    pid = processId;
+    symbols = programSymbols;
+    counts = new int[symbols->numSymbols + 1];
+    for (int i = 0; i <= symbols->numSymbols; i++)
+	counts[i] = 0;
+    total = 0;
+    last = 0;
+    next = NULL;
+}
+
+ProcessProfile::~ProcessProfile()
+{
+    delete [] counts;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Profiler
+// 	Initialize the profiler.
+//
+//	"sampleInterval" -- # of ticks between samples; 0 means count
+//		every user instruction
+//----------------------------------------------------------------------
+
+Profiler::Profiler(int sampleInterval)
+{
+    interval = sampleInterval;
+    nextSample = 0;
+    programs = NULL;
+    profiles = lastProfile = NULL;
+    current = new ProcessProfile *[MAX_THREAD_COUNT];
+    for (int i = 0; i < MAX_THREAD_COUNT; i++)
+	current[i] = NULL;
+}
+
+Profiler::~Profiler()
+{
+    while (profiles != NULL) {
+	ProcessProfile *p = profiles;
+	profiles = p->next;
+	delete p;
+    }
+    while (programs != NULL) {
+	SymbolTable *s = programs;
+	programs = s->next;
+	delete s;
+    }
+    delete [] current;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Symbols
+// 	Return the symbols of "program", reading them the first time
+//	it is run.
+//----------------------------------------------------------------------
+
+SymbolTable *
+Profiler::Symbols(char *program)
+{
+    SymbolTable *s;
+
+    for (s = programs; s != NULL; s = s->next)
+	if (!strcmp(s->program, program))
+	    return s;
+    s = new SymbolTable(program);
+    s->next = programs;
+    programs = s;
+    return s;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Start
+// 	Begin a new profile for process "pid", and make it the one that
+//	the process's samples are charged to.
+//----------------------------------------------------------------------
+
+ProcessProfile *
+Profiler::Start(int pid, SymbolTable *symbols)
+{
+    ProcessProfile *p = new ProcessProfile(pid, symbols);
+
+    if (lastProfile == NULL)
+	profiles = p;
+    else
+	lastProfile->next = p;
+    lastProfile = p;
+    current[pid] = p;
+    return p;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Exec
+// 	Called when process "pid" loads a new program (at startup, from
+//	a batch file, or by the Exec system call).
+//----------------------------------------------------------------------
+
+void
+Profiler::Exec(int pid, char *program)
+{
+    Start(pid, Symbols(program));
+}
+
+//----------------------------------------------------------------------
+// Profiler::Fork
+// 	Called when process "parentPid" forks "childPid"; the child runs
+//	the same program as its parent, but gets its own profile.
+//----------------------------------------------------------------------
+
+void
+Profiler::Fork(int parentPid, int childPid)
+{
+    if (current[parentPid] != NULL)
+	Start(childPid, current[parentPid]->symbols);
+}
+
+//----------------------------------------------------------------------
+// Profiler::Sample
+// 	Charge a sample to the function containing "pc", in the current
+//	process, and work out when the next sample is due.
+//
+//	"now" -- the current time, at or after the time the sample was due
+//----------------------------------------------------------------------
+
+void
+Profiler::Sample(int pc, int now)
+{
+    int pid = currentThread->GetPID();
+    ProcessProfile *p = current[pid];
+
+    if (p == NULL)			// we missed the Exec; shouldn't
+	p = Start(pid, Symbols((char *) "?"));	// happen, but don't lose samples
+    p->last = p->symbols->Find(pc, p->last);
+    p->counts[p->last]++;
+    p->total++;
+
+    if (interval > 0)
+	nextSample = (now / interval + 1) * interval;
+}
+
+//----------------------------------------------------------------------
+// FunctionCount
+// 	One line of a profile, for sorting.
+//----------------------------------------------------------------------
+
+struct FunctionCount {
+    int count;
+    char *name;
+    char *program;
+};
+
+static int
+CompareCounts(const void *a, const void *b)
+{
+    const FunctionCount *x = (const FunctionCount *) a;
+    const FunctionCount *y = (const FunctionCount *) b;
+
+    if (x->count != y->count)
+	return (x->count > y->count) ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+//----------------------------------------------------------------------
+// PrintCounts
+// 	Print "n" lines of a profile, busiest function first.  The
+//	program is only named if "withProgram" is TRUE.
+//----------------------------------------------------------------------
+
+static void
+PrintCounts(FunctionCount *lines, int n, int total, bool withProgram)
+{
+    qsort(lines, n, sizeof(FunctionCount), CompareCounts);
+    for (int i = 0; i < n; i++) {
+	if (lines[i].count == 0)
+	    break;
+	printf("%10d %5.1f%%  %s", lines[i].count,
+	       (100.0 * lines[i].count) / total, lines[i].name);
+	if (withProgram)
+	    printf(" (%s)", lines[i].program);
+	printf("\n");
+    }
+}
+
+//----------------------------------------------------------------------
+// Profiler::Print
+// 	Print a flat profile of every function in every program, and then
+//	the profile of each process.
+//----------------------------------------------------------------------
+
+void
+Profiler::Print()
+{
+    ProcessProfile *p;
+    SymbolTable *s;
+    int total = 0, numLines = 0, n, i;
+
+    for (s = programs; s != NULL; s = s->next)
+	numLines += s->numSymbols + 1;
+    for (p = profiles; p != NULL; p = p->next)
+	total += p->total;
+
+    printf("\nProfile: %d samples, ", total);
+    if (interval > 0)
+	printf("one every %d ticks\n", interval);
+    else
+	printf("one per user instruction\n");
+    if (total == 0)
+	return;
+
+    // Flat profile: add up the processes running each program.
+    FunctionCount *lines = new FunctionCount[numLines];
+    n = 0;
+    for (s = programs; s != NULL; s = s->next) {
+	for (i = 0; i <= s->numSymbols; i++) {
+	    lines[n + i].count = 0;
+	    lines[n + i].name = (i < s->numSymbols) ? s->name[i]
+						     : (char *) "<unknown>";
+	    lines[n + i].program = s->program;
+	}
+	for (p = profiles; p != NULL; p = p->next)
+	    if (p->symbols == s)
+		for (i = 0; i <= s->numSymbols; i++)
+		    lines[n + i].count += p->counts[i];
+	n += s->numSymbols + 1;
+    }
+    printf("\n   samples      %%  function\n");
+    PrintCounts(lines, n, total, TRUE);
+
+    for (p = profiles; p != NULL; p = p->next) {
+	if (p->total == 0)
+	    continue;
+	printf("\n[pid %d] %s: %d samples, %.1f%%\n", p->pid,
+	       p->symbols->program, p->total, (100.0 * p->total) / total);
+	s = p->symbols;
+	for (i = 0; i <= s->numSymbols; i++) {
+	    lines[i].count = p->counts[i];
+	    lines[i].name = (i < s->numSymbols) ? s->name[i]
+						 : (char *) "<unknown>";
+	    lines[i].program = s->program;
+	}
+	PrintCounts(lines, s->numSymbols + 1, p->total, FALSE);
+    }
+    delete [] lines;
+}
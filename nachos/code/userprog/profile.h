@@ -0,0 +1,94 @@
+// profile.h
+//	Data structures for profiling user programs.
+//
+//	When profiling is turned on (with -prof), the simulator records
+//	where each user program is spending its time: every "interval"
+//	ticks it looks at the PC of the instruction about to run, and
+//	charges a sample to the function containing it.  An interval of
+//	0 charges every user instruction instead.
+//
+//	Functions are found using the symbol table that the compiler
+//	left in the program's .coff file (the NOFF file we actually run
+//	doesn't have one).  When Nachos halts, we print a flat profile
+//	of the whole run, then a breakdown for each process.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+
+// The following class defines the functions of one user program,
+// sorted by address.  A program's symbols are read once, and shared
+// by every process running it.
+
+class SymbolTable {
+  public:
+    SymbolTable(char *program);		// read the symbols of "program"
+    ~SymbolTable();
+
+    int Find(int addr, int hint);	// index of the function holding
+					// "addr"; "hint" is tried first
+
+    char *program;			// name of the NOFF executable
+    int numSymbols;			// 0 if we couldn't read the symbols
+    int *address;			// where each function starts
+    char **name;			// ... and what it's called
+    char *strings;			// space for the names
+
+    SymbolTable *next;			// next program we have symbols for
+};
+
+// The samples charged to one process, while it runs one program.
+// An Exec starts a new ProcessProfile for the same pid.
+
+class ProcessProfile {
+  public:
+    ProcessProfile(int pid, SymbolTable *symbols);
+    ~ProcessProfile();
+
+    int pid;
+    SymbolTable *symbols;		// the program being run
+    int *counts;			// samples for each function; the
+					// last entry is for unknown code
+    int total;				// samples in all
+    int last;				// function of the last sample
+
+    ProcessProfile *next;		// in order of creation
+};
+
+// The following class defines the profiler.  There is one, created
+// by Initialize if -prof was given.
+
+class Profiler {
+  public:
+    Profiler(int sampleInterval);	// sample every "sampleInterval"
+					// ticks, or every instruction if 0
+    ~Profiler();
+
+    void Exec(int pid, char *program);	// process "pid" starts "program"
+    void Fork(int parentPid, int childPid);  // the child runs its
+					// parent's program
+
+    void Tick(int pc, int now)		// about to run the user
+	{ if (now >= nextSample) Sample(pc, now); }	// instruction at "pc"
+
+    void Print();			// print the profiles
+
+  private:
+    void Sample(int pc, int now);	// charge a sample to "pc"
+    SymbolTable *Symbols(char *program);  // find or read the symbols
+    ProcessProfile *Start(int pid, SymbolTable *symbols);
+
+    int interval;			// ticks between samples
+    int nextSample;			// when to take the next sample
+    SymbolTable *programs;		// symbols read so far
+    ProcessProfile *profiles;		// every profile, oldest first
+    ProcessProfile *lastProfile;	// newest profile
+    ProcessProfile **current;		// profile for each pid
+};
+
+#endif // PROFILE_H
@@ -21,7 +21,7 @@
 //	memory, and jump to it.
 //----------------------------------------------------------------------
 void
-BulkStartFunction (int dummy)
+BulkStartFunction (intptr_t dummy)
 {
    currentThread->Startup();
    machine->Run();
@@ -37,14 +37,23 @@ StartUserProcess(char *filename)
 	printf("Unable to open file %s\n", filename);
 	return;
     }
+    if (currentThread->space != NULL) {	// Exec: the old program is
+	delete currentThread->space;		// gone, and its frames free
+	currentThread->space = NULL;
+    }
     space = new ProcessAddrSpace(executable);    
     currentThread->space = space;
+    if (profiler != NULL)
+	profiler->Exec(currentThread->GetPID(), filename);
 
-    delete executable;			// close file
+#ifndef VM
+    delete executable;			// close file (in the vm build, the
+#endif					// address space keeps it)
 
     space->InitUserCPURegisters();		// set the initial register values
     space->RestoreStateOnSwitch();		// load page table register
 
+    currentThread->resumePoint = ResumeInUser;
     machine->Run();			// jump to the user progam
     ASSERT(FALSE);			// machine->Run never returns;
 					// the address space exits
@@ -65,12 +74,17 @@ BulkAdd(char *filename,int p)
     NachOSThread *BatchAdd;
     BatchAdd = new NachOSThread("Batch Added thread");
     BatchAdd->space = new ProcessAddrSpace(executable);
-    delete executable;          // close file
+    if (profiler != NULL)
+	profiler->Exec(BatchAdd->GetPID(), filename);
+#ifndef VM
+    delete executable;          // close file (kept by the address space
+#endif				// in the vm build)
     BatchAdd->priority = p;  // Setting Priority for new Thread.
     BatchAdd->space->InitUserCPURegisters();      // set the initial register values
     BatchAdd->SaveUserState();
     BatchAdd->space->RestoreStateOnSwitch(); 
     BatchAdd->AllocateThreadStack (BulkStartFunction,0);     // Make it ready for a later context switch
+    BatchAdd->resumePoint = ResumeInUser;
     BatchAdd->SetBasePriority();
     BatchAdd->Schedule ();     // load page table register
     //BatchAdd->ThreadFork(BulkStartFunction,0);
@@ -79,17 +93,17 @@ BulkAdd(char *filename,int p)
 // Data structures needed for the console test.  Threads making
 // I/O requests wait on a Semaphore to delay until the I/O completes.
 
-static Console *console;
-static Semaphore *readAvail;
-static Semaphore *writeDone;
+static thread_local Console *console;
+static thread_local Semaphore *readAvail;
+static thread_local Semaphore *writeDone;
 
 //----------------------------------------------------------------------
 // ConsoleInterruptHandlers
 // 	Wake up the thread that requested the I/O.
 //----------------------------------------------------------------------
 
-static void ReadAvail(int arg) { readAvail->V(); }
-static void WriteDone(int arg) { writeDone->V(); }
+static void ReadAvail(intptr_t arg) { readAvail->V(); }
+static void WriteDone(intptr_t arg) { writeDone->V(); }
 
 //----------------------------------------------------------------------
 // ConsoleTest
@@ -0,0 +1,168 @@
+// backingstore.cc
+//	Routines to save evicted pages of an address space, and read them
+//	back.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "backingstore.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// BackingStore::BackingStore
+// 	Set up an empty backing store.
+//
+//	"size" -- the number of pages in the address space
+//----------------------------------------------------------------------
+
+BackingStore::BackingStore(int size)
+{
+    numPages = size;
+    slots = new int[numPages];
+    for (int i = 0; i < numPages; i++)
+	slots[i] = -1;
+}
+
+//----------------------------------------------------------------------
+// BackingStore::BackingStore
+// 	Copy the backing store of a process that is forking, so that the
+//	child finds the parent's evicted pages as they were at the fork.
+//	The two share the slots, until one of them writes the page out
+//	again.
+//
+//	"parent" -- the store to copy
+//----------------------------------------------------------------------
+
+BackingStore::BackingStore(BackingStore *parent)
+{
+    numPages = parent->numPages;
+    slots = new int[numPages];
+    for (int i = 0; i < numPages; i++) {
+	slots[i] = parent->slots[i];
+	if (slots[i] != -1)
+	    swapSpace->AddReference(slots[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// BackingStore::~BackingStore
+// 	Give back the slots of the saved pages.
+//----------------------------------------------------------------------
+
+BackingStore::~BackingStore()
+{
+    for (int i = 0; i < numPages; i++)
+	if (slots[i] != -1)
+	    swapSpace->Release(slots[i]);
+    delete [] slots;
+}
+
+//----------------------------------------------------------------------
+// BackingStore::Contains, Read
+// 	Check whether a page has been written out, or read it back.
+//
+//	"vpn" -- the virtual page
+//	"into" -- PageSize bytes of memory
+//----------------------------------------------------------------------
+
+bool
+BackingStore::Contains(int vpn)
+{
+    ASSERT((vpn >= 0) && (vpn < numPages));
+    return slots[vpn] != -1;
+}
+
+void
+BackingStore::Read(int vpn, char *into)
+{
+    ASSERT(Contains(vpn));
+    swapSpace->Read(slots[vpn], into);
+}
+
+//----------------------------------------------------------------------
+// BackingStore::Assign
+// 	Give slots to a cluster of pages that are about to be written
+//	out.  A page that already has one keeps it, unless the slot is
+//	shared with another backing store after a fork; the rest get new
+//	ones, in a row if there is room, so that they can be read back
+//	from the disk's track buffer.
+//
+//	"vpns" -- the virtual pages
+//	"count" -- the number of pages, at most MaxCluster
+//----------------------------------------------------------------------
+
+void
+BackingStore::Assign(int *vpns, int count)
+{
+    int numNew = 0, first;
+    int i;
+
+    ASSERT((count > 0) && (count <= MaxCluster));
+    for (i = 0; i < count; i++) {
+	ASSERT((vpns[i] >= 0) && (vpns[i] < numPages));
+	if ((slots[vpns[i]] != -1) && swapSpace->IsShared(slots[vpns[i]])) {
+	    swapSpace->Release(slots[vpns[i]]);
+	    slots[vpns[i]] = -1;
+	}
+	if (slots[vpns[i]] == -1)
+	    numNew++;
+    }
+    first = (numNew > 0) ? swapSpace->Allocate(numNew) : -1;
+    for (i = 0; i < count; i++) {
+	if (slots[vpns[i]] == -1) {
+	    if (first != -1)
+		slots[vpns[i]] = first++;
+	    else
+		slots[vpns[i]] = swapSpace->Allocate(1);
+	    ASSERT(slots[vpns[i]] != -1);	// the swap area is full
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// BackingStore::Share
+// 	Save a page in the same slot as another backing store does: the
+//	page is in a frame the two address spaces share, which has been
+//	given a slot in "other", and is about to be written out there.
+//
+//	"vpn" -- the virtual page
+//	"other" -- the backing store that Assign gave the slot to
+//----------------------------------------------------------------------
+
+void
+BackingStore::Share(int vpn, BackingStore *other)
+{
+    ASSERT(other->Contains(vpn));
+    if (slots[vpn] != -1)
+	swapSpace->Release(slots[vpn]);
+    slots[vpn] = other->slots[vpn];
+    swapSpace->AddReference(slots[vpn]);
+}
+
+//----------------------------------------------------------------------
+// BackingStore::Write
+// 	Write a cluster of pages out to the slots that Assign gave them,
+//	over any earlier copies.
+//
+//	We wait for the disk, and our address space may be gone by the
+//	time it is done, so nothing here is touched afterwards.
+//
+//	"vpns" -- the virtual pages
+//	"pages" -- where each is, in mainMemory
+//	"count" -- the number of pages, at most MaxCluster
+//----------------------------------------------------------------------
+
+void
+BackingStore::Write(int *vpns, char **pages, int count)
+{
+    int cluster[MaxCluster];
+
+    ASSERT((count > 0) && (count <= MaxCluster));
+    for (int i = 0; i < count; i++) {
+	ASSERT(Contains(vpns[i]));
+	cluster[i] = slots[vpns[i]];
+    }
+    swapSpace->Write(cluster, pages, count);
+}
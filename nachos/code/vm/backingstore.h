@@ -0,0 +1,47 @@
+// backingstore.h
+//	Data structures for the backing store of an address space: where
+//	its pages go when they are evicted from memory with changes that
+//	can't be read back from the program file.
+//
+//	A page is given a slot in the swap area (see swapspace.h) when it
+//	is first written out, and is read back from there from then on,
+//	rather than from the program file.  Pages are written out a
+//	cluster at a time, with the slots of those written out for the
+//	first time put in a row where possible.  A page in a frame shared
+//	by several address spaces is written out once, and their backing
+//	stores share its slot.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BACKINGSTORE_H
+#define BACKINGSTORE_H
+
+#include "copyright.h"
+
+// The following class defines the backing store of one address space.
+
+class BackingStore {
+  public:
+    BackingStore(int size);		// an empty store for an address
+					// space of "size" pages
+    BackingStore(BackingStore *parent);	// a copy of "parent", for fork
+    ~BackingStore();
+
+    bool Contains(int vpn);		// has page "vpn" been written out?
+    void Assign(int *vpns, int count);	// give "count" pages, at most
+					// MaxCluster, slots to go in
+    void Share(int vpn, BackingStore *other);
+					// use the slot "other" has for "vpn"
+    void Write(int *vpns, char **pages, int count);
+					// save the pages from mainMemory
+    void Read(int vpn, char *into);	// and read one back
+
+  private:
+    int numPages;
+    int *slots;				// where each page written out is in
+					// the swap area, or -1
+};
+
+#endif // BACKINGSTORE_H
@@ -0,0 +1,567 @@
+// frametable.cc
+//	Routines to keep track of what is in each physical frame, and to
+//	choose pages to evict when memory is full.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "frametable.h"
+#include "system.h"
+
+static char *policyNames[] = { "fifo", "random", "clock", "aging" };
+
+//----------------------------------------------------------------------
+// PageCleaner
+// 	Where the page cleaner thread starts.
+//----------------------------------------------------------------------
+
+static void
+PageCleaner(intptr_t dummy)
+{
+    currentThread->Startup();
+    frameTable->RunCleaner();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the frame table: all frames are free.
+//
+//	"replacementPolicy" -- how to choose pages to evict
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(ReplacementPolicy replacementPolicy)
+{
+    policy = replacementPolicy;
+    frames = new FrameInfo[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++) {
+	frames[i].inUse = FALSE;
+	frames[i].owner = NULL;
+	frames[i].vpn = -1;
+	frames[i].loaded = 0;
+	frames[i].age = 0;
+	frames[i].busy = FALSE;
+    }
+    numLoaded = 0;
+    hand = 0;
+    seed = 1;
+    numBusy = numWaiting = 0;
+    ioDone = new Semaphore("frame I/O done", 0);
+    cleanTarget = (NumPhysPages + 7) / 8;
+    if (cleanTarget < 2)		// one would leave the cleaner idle
+	cleanTarget = 2;		// with less than 16 frames
+    cleanerIdle = FALSE;
+    cleanerWakeup = new Semaphore("page cleaner", 0);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::~FrameTable
+// 	De-allocate the frame table.
+//----------------------------------------------------------------------
+
+FrameTable::~FrameTable()
+{
+    delete [] frames;
+    delete ioDone;
+    delete cleanerWakeup;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::PolicyName
+// 	Return the name of the replacement policy, as given to -pr.
+//----------------------------------------------------------------------
+
+char *
+FrameTable::PolicyName()
+{
+    return policyNames[policy];
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Loaded
+// 	Note that an address space has brought a page into a frame.
+//	For aging, the page counts as just used: otherwise it would be
+//	the first to go, and two pages that one instruction needs could
+//	take turns evicting each other until the next timer interrupt.
+//
+//	"frame" -- the frame, just allocated
+//	"space" -- the address space
+//	"vpn" -- the virtual page now in the frame
+//----------------------------------------------------------------------
+
+void
+FrameTable::Loaded(int frame, ProcessAddrSpace *space, int vpn)
+{
+    FrameInfo *info = &frames[frame];
+
+    info->inUse = TRUE;
+    info->owner = space;
+    info->vpn = vpn;
+    info->loaded = numLoaded++;
+    info->age = 0x80;
+    info->busy = FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Disowned
+// 	Note that an address space has stopped using a frame that it
+//	shared with others.  If it was the one we knew about, we no longer
+//	know who is using the frame; Sharer finds out, if it needs to.
+//
+//	"frame" -- the frame, still in use
+//	"space" -- the address space that has let go of it
+//----------------------------------------------------------------------
+
+void
+FrameTable::Disowned(int frame, ProcessAddrSpace *space)
+{
+    if (frames[frame].owner == space)
+	frames[frame].owner = NULL;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Released
+// 	Note that a frame is free.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Released(int frame)
+{
+    frames[frame].inUse = FALSE;
+    frames[frame].owner = NULL;
+    frames[frame].busy = FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::StartIO, EndIO, IsBusy
+// 	Note that the page in a frame is being read in or written out,
+//	so it mustn't be evicted, and that it is done.  The frame may
+//	have been freed and given to another page by the time a write is
+//	done, if the address space went away; StartIO returns a stamp
+//	that lets EndIO tell.  Faults waiting for a busy frame are woken
+//	to look again.
+//
+//	"frame" -- the frame
+//	"stamp" -- what StartIO returned
+//----------------------------------------------------------------------
+
+unsigned
+FrameTable::StartIO(int frame)
+{
+    ASSERT(frames[frame].inUse && !frames[frame].busy);
+    frames[frame].busy = TRUE;
+    numBusy++;
+    return frames[frame].loaded;
+}
+
+void
+FrameTable::EndIO(int frame, unsigned stamp)
+{
+    if (frames[frame].loaded == stamp)
+	frames[frame].busy = FALSE;
+    numBusy--;
+    while (numWaiting > 0) {
+	numWaiting--;
+	ioDone->V();
+    }
+}
+
+bool
+FrameTable::IsBusy(int frame)
+{
+    return frames[frame].inUse && frames[frame].busy;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::WaitForIO
+// 	Wait until some busy frame is done with.
+//----------------------------------------------------------------------
+
+void
+FrameTable::WaitForIO()
+{
+    ASSERT(numBusy > 0);
+    numWaiting++;
+    ioDone->P();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Sharer
+// 	Find an address space using a frame.  We know the address space
+//	using a frame that isn't shared, once we have found it; for one
+//	that is, look through the threads for the address spaces mapping
+//	it.  Exiting processes aren't looked at, as their threads may be
+//	gone.
+//
+//	Returns NULL if there aren't that many.
+//
+//	"frame" -- the frame, in use
+//	"n" -- which address space to return, counting from 0
+//----------------------------------------------------------------------
+
+ProcessAddrSpace *
+FrameTable::Sharer(int frame, int n)
+{
+    FrameInfo *info = &frames[frame];
+    bool shared = (frameReferences[frame] > 1);
+    ProcessAddrSpace *space;
+    TranslationEntry *entry;
+
+    if (!shared && (info->owner != NULL))
+	return (n == 0) ? info->owner : NULL;
+    for (unsigned i = 0; i < thread_index; i++) {
+	if ((threadArray[i] == NULL) || exitThreadArray[i])
+	    continue;
+	space = threadArray[i]->space;
+	if ((space != NULL)
+		&& ((entry = space->GetPageEntry(info->vpn)) != NULL)
+		&& (entry->physicalPage == frame) && (n-- == 0)) {
+	    if (!shared)
+		info->owner = space;
+	    return space;
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::CanEvict
+// 	Return TRUE if the page in a frame may be evicted: the frame isn't
+//	free or busy, and we can find every address space using it.
+//
+//	"frame" -- the frame to look at
+//----------------------------------------------------------------------
+
+bool
+FrameTable::CanEvict(int frame)
+{
+    FrameInfo *info = &frames[frame];
+
+    return info->inUse && !info->busy
+	&& (Sharer(frame, frameReferences[frame] - 1) != NULL);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::LoadedLast
+// 	Return TRUE if the page in a frame is the last that an address
+//	space brought in, of those it still has in memory.
+//
+//	"frame" -- the frame, in use
+//	"space" -- the address space
+//----------------------------------------------------------------------
+
+bool
+FrameTable::LoadedLast(int frame, ProcessAddrSpace *space)
+{
+    if (frames[frame].owner != space)
+	return FALSE;
+    for (int i = 0; i < NumPhysPages; i++)
+	if (frames[i].inUse && (frames[i].owner == space)
+		&& (frames[i].loaded > frames[frame].loaded))
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::IsUsed, IsDirty
+// 	Return TRUE if the page in a frame has been used since its use
+//	bits were last cleared, or changed since it was brought in or
+//	written out, by any of the address spaces using it.
+//
+//	"frame" -- the frame, which CanEvict
+//----------------------------------------------------------------------
+
+bool
+FrameTable::IsUsed(int frame)
+{
+    ProcessAddrSpace *space;
+
+    for (int n = 0; (space = Sharer(frame, n)) != NULL; n++)
+	if (space->GetPageEntry(frames[frame].vpn)->use)
+	    return TRUE;
+    return FALSE;
+}
+
+bool
+FrameTable::IsDirty(int frame)
+{
+    ProcessAddrSpace *space;
+
+    for (int n = 0; (space = Sharer(frame, n)) != NULL; n++)
+	if (space->GetPageEntry(frames[frame].vpn)->dirty)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::ClearUse
+// 	Clear the use bits of the page in a frame.  With a TLB, its TLB
+//	entries are dropped too, so that the next access to the page
+//	misses and sets the use bit again (see
+//	ProcessAddrSpace::LoadTLBEntry).
+//
+//	"frame" -- the frame, which CanEvict
+//----------------------------------------------------------------------
+
+void
+FrameTable::ClearUse(int frame)
+{
+    ProcessAddrSpace *space;
+
+    for (int n = 0; (space = Sharer(frame, n)) != NULL; n++) {
+	space->GetPageEntry(frames[frame].vpn)->use = FALSE;
+#ifdef USE_TLB
+	machine->InvalidateTLBEntry(space->GetASID(), frames[frame].vpn);
+#endif
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Age
+// 	For the aging policy, called at each timer interrupt: shift each
+//	page's use bit into the top of its age, and clear it.  The host
+//	TLB is flushed, so that the next access to each page goes through
+//	Machine::Translate and sets the use bit again.
+//----------------------------------------------------------------------
+
+void
+FrameTable::Age()
+{
+    bool used;
+
+    if (policy != AgingReplacement)
+	return;
+    for (int i = 0; i < NumPhysPages; i++) {
+	if (!CanEvict(i))
+	    continue;
+	used = IsUsed(i);
+	frames[i].age = (frames[i].age >> 1) | (used ? 0x80 : 0);
+	if (used)
+	    ClearUse(i);
+    }
+    machine->FlushHostTLB();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::ChooseVictim
+// 	Pick a frame whose page is to be evicted, by the replacement
+//	policy.
+//
+//	Returns the frame, or -1 if no page can be evicted.
+//----------------------------------------------------------------------
+
+int
+FrameTable::ChooseVictim()
+{
+    int victim = -1;
+    int i, frame;
+
+    switch (policy) {
+      case FIFOReplacement:
+      case AgingReplacement:
+	for (i = 0; i < NumPhysPages; i++)
+	    if (CanEvict(i) && ((victim == -1) || EvictedBefore(i, victim)))
+		victim = i;
+	break;
+      case RandomReplacement:
+	seed = seed * 1103515245 + 12345;
+	frame = (seed >> 16) % NumPhysPages;
+	for (i = 0; (victim == -1) && (i < NumPhysPages); i++)
+	    if (CanEvict((frame + i) % NumPhysPages))
+		victim = (frame + i) % NumPhysPages;
+	break;
+      case ClockReplacement:
+	// Twice round is enough to find a page whose use bit is clear,
+	// if there are any pages we can evict at all.
+	for (i = 0; (victim == -1) && (i < 2 * NumPhysPages); i++) {
+	    frame = hand;
+	    hand = (hand + 1) % NumPhysPages;
+	    if (!CanEvict(frame))
+		continue;
+	    if (IsUsed(frame))
+		ClearUse(frame);		// a second chance
+	    else
+		victim = frame;
+	}
+	machine->FlushHostTLB();		// see Age
+	break;
+    }
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::EvictedBefore
+// 	Return TRUE if the replacement policy would evict the page in
+//	"frame" before the one in "other": for fifo, if it was brought in
+//	first; for aging, if it is older; for clock, if the hand gets to
+//	it first, counting a page whose use bit is set as a turn further
+//	on.  Random has no order, and goes by fifo's.
+//
+//	"frame", "other" -- frames whose pages could be evicted
+//----------------------------------------------------------------------
+
+bool
+FrameTable::EvictedBefore(int frame, int other)
+{
+    int distance, otherDistance;
+
+    switch (policy) {
+      case ClockReplacement:
+	distance = (frame - hand + NumPhysPages) % NumPhysPages;
+	if (IsUsed(frame))
+	    distance += NumPhysPages;
+	otherDistance = (other - hand + NumPhysPages) % NumPhysPages;
+	if (IsUsed(other))
+	    otherDistance += NumPhysPages;
+	return distance < otherDistance;
+      case AgingReplacement:
+	if (frames[frame].age != frames[other].age)
+	    return frames[frame].age < frames[other].age;
+	break;
+      default:
+	break;
+    }
+    return frames[frame].loaded < frames[other].loaded;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::MakeRoom
+// 	Called before a page is brought in.  If there is no free frame,
+//	evict a page to make one.  If the victim is dirty, it is written
+//	out first, which means waiting for the disk; then it is evicted,
+//	unless it has changed again or been freed by then, in which case
+//	we start over.  A shared page is evicted from every address space
+//	using it.
+//
+//	We may have to wait, and other threads may run meanwhile, but
+//	there is a free frame when we return.
+//
+//	The page the faulting process brought in last isn't evicted while
+//	other frames are busy: the instruction that faulted may need it
+//	as well, and with every other frame waiting for the disk, the two
+//	pages would take turns evicting each other, with the process
+//	never giving up the disk to the writes that would free a frame.
+//	We wait for one of them instead.
+//
+//	If taking the free frame will leave too few free frames and clean
+//	pages, the page cleaner is woken, so that it starts before a fault
+//	has to write a page itself.
+//----------------------------------------------------------------------
+
+void
+FrameTable::MakeRoom()
+{
+    int victim, vpn;
+    unsigned stamp;
+
+    while (frameMap->NumClear() == 0) {
+	victim = ChooseVictim();
+	if (victim == -1) {
+	    ASSERT(numBusy > 0);	// every page is being read or written
+	    DEBUG('a', "No page to evict: waiting for the disk\n");
+	    WaitForIO();
+	    continue;
+	}
+	vpn = frames[victim].vpn;
+	if ((numBusy > 0) && LoadedLast(victim, currentThread->space)) {
+	    DEBUG('a', "Victim virtual page %d in frame %d was our last "
+		  "page brought in: waiting for the disk\n", vpn, victim);
+	    WaitForIO();
+	    continue;
+	}
+	if (IsDirty(victim)) {
+	    DEBUG('a', "Victim virtual page %d in frame %d is dirty: "
+		  "waiting for it to be written out\n", vpn, victim);
+	    stats->numWritebackWaits++;
+	    stamp = frames[victim].loaded;
+	    Sharer(victim, 0)->CleanPages(vpn);
+	    if ((frames[victim].loaded != stamp) || !CanEvict(victim)
+		    || IsDirty(victim))
+		continue;
+	}
+	DEBUG('a', "Evicting virtual page %d from frame %d (%s)\n",
+	      vpn, victim, PolicyName());
+	stats->numEvictions++;
+	while (frames[victim].inUse)
+	    Sharer(victim, 0)->EvictPage(vpn);
+    }
+    if (NextToClean(1) != -1)
+	WakeCleaner();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::WakeCleaner
+// 	Start the page cleaner on writing out pages, if it isn't already.
+//	It is created the first time it is needed, and has the swap disk
+//	ahead of the faults from then on.  It isn't a process that Exit
+//	waits for (the last process to exit halts Nachos with the cleaner
+//	still asleep); FreeThreads deletes it when Nachos halts.
+//----------------------------------------------------------------------
+
+void
+FrameTable::WakeCleaner()
+{
+    if (pageCleaner == NULL) {
+	pageCleaner = new NachOSThread("page cleaner");
+	pageCleaner->ThreadFork(PageCleaner, 0);
+	swapSpace->Prefer(pageCleaner);
+    } else if (cleanerIdle) {
+	cleanerIdle = FALSE;
+	cleanerWakeup->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameTable::RunCleaner
+// 	The page cleaner: write out dirty pages, a cluster at a time,
+//	until there are enough clean ones; then wait to be woken again.
+//----------------------------------------------------------------------
+
+void
+FrameTable::RunCleaner()
+{
+    int frame;
+
+    for (;;) {
+	while ((frame = NextToClean(0)) != -1) {
+	    DEBUG('a', "Page cleaner: writing out virtual page %d from "
+		  "frame %d\n", frames[frame].vpn, frame);
+	    stats->numCleanerWrites
+		+= Sharer(frame, 0)->CleanPages(frames[frame].vpn);
+	}
+	cleanerIdle = TRUE;
+	cleanerWakeup->P();
+    }
+}
+
+//----------------------------------------------------------------------
+// FrameTable::NextToClean
+// 	Choose a page for the page cleaner to write out: the dirty page
+//	that the policy would evict first, unless there are enough free
+//	frames, and clean pages that would be evicted before it, for the
+//	next few faults not to have to wait.
+//
+//	Returns -1 if there is nothing to do.
+//
+//	"taken" -- how many of the free frames are about to be taken
+//----------------------------------------------------------------------
+
+int
+FrameTable::NextToClean(int taken)
+{
+    int ready = frameMap->NumClear() - taken;
+    int next = -1;
+    int i;
+
+    for (i = 0; i < NumPhysPages; i++)
+	if (CanEvict(i) && IsDirty(i)
+		&& ((next == -1) || EvictedBefore(i, next)))
+	    next = i;
+    if (next == -1)
+	return -1;
+    for (i = 0; (i < NumPhysPages) && (ready < cleanTarget); i++)
+	if (CanEvict(i) && !IsDirty(i) && EvictedBefore(i, next))
+	    ready++;
+    return (ready >= cleanTarget) ? -1 : next;
+}
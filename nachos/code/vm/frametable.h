@@ -0,0 +1,148 @@
+// frametable.h
+//	Data structures for the frame table of the vm build: which page
+//	of which address space each physical frame holds, and how to pick
+//	a frame to take back when memory is full.
+//
+//	When a page fault finds no free frame, the frame table chooses a
+//	victim with the replacement policy given by -pr:
+//
+//	fifo -- the page that was brought in longest ago
+//	random -- any page
+//	clock -- second chance: a hand sweeps round the frames, clearing
+//		the use bit of each page it passes, and stops at the
+//		first page whose use bit is already clear
+//	aging -- an approximation of least recently used: at every
+//		timer interrupt, each page's age is shifted right, with
+//		its use bit (which is then cleared) as the new top bit;
+//		the page with the lowest age goes
+//
+//	All four go by the use and dirty bits that Machine::Translate sets
+//	in the page table (or, with a TLB, that the TLB miss handler sets).
+//	The victim's address space takes the page out of its page table.
+//
+//	Only clean pages are evicted.  A dirty page is first written to
+//	swap, together with the dirty pages next to it in its address
+//	space (see ProcessAddrSpace::CleanPages), and the fault waits for
+//	the disk.  To make that rare, a kernel thread, the page cleaner,
+//	keeps enough free frames and clean pages to evict (an eighth of
+//	memory, and at least two frames) that the next few faults won't
+//	have to wait.  Whenever a fault is about to take a frame and leave
+//	fewer than that, the cleaner is woken, and writes out the dirty
+//	pages that the policy would evict first.  It has the swap disk
+//	ahead of the faults: when it is waiting for the disk, the disk is
+//	handed to it as soon as the sector being transferred is done.
+//
+//	A frame whose page is being read in or written out is busy, and
+//	isn't chosen meanwhile.  If every frame that could be evicted is
+//	busy, the fault waits for one of them.
+//
+//	A frame may be shared copy-on-write after a fork, or hold a code
+//	page shared by processes running the same program.  Its page is
+//	taken out of every address space using it at once, and counts as
+//	used if any of them has used it.  A shared dirty page is written
+//	out once, to a slot that all their backing stores share.  Only
+//	one address space is noted as using each frame, so the others are
+//	found by looking through the threads; a frame still used by one
+//	that can't be found that way (its process is exiting) isn't
+//	chosen.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "translate.h"
+#include "synch.h"
+
+class ProcessAddrSpace;
+
+// The page replacement policies
+
+enum ReplacementPolicy { FIFOReplacement, RandomReplacement,
+			 ClockReplacement, AgingReplacement };
+
+// What the frame table knows about one frame.
+
+class FrameInfo {
+  public:
+    bool inUse;			// is a page in the frame?
+    ProcessAddrSpace *owner;	// whose page it is, or NULL if it is
+				// or was shared, and it isn't known
+				// (see FrameTable::Sharer)
+    int vpn;			// which page (the same in every address
+				// space sharing the frame)
+    unsigned loaded;		// when the page was brought in, counting
+				// pages brought in
+    unsigned char age;		// for aging: recent use bits, latest
+				// on top
+    bool busy;			// is the page being read or written?
+};
+
+// The following class defines the frame table.
+
+class FrameTable {
+  public:
+    FrameTable(ReplacementPolicy replacementPolicy);
+					// no frames in use, and replace
+					// pages using "replacementPolicy"
+    ~FrameTable();
+
+    void MakeRoom();			// if no frame is free, evict a page
+    void Loaded(int frame, ProcessAddrSpace *space, int vpn);
+					// page "vpn" of "space" is now in
+					// "frame"
+    void Disowned(int frame, ProcessAddrSpace *space);
+					// "space" no longer uses the shared
+					// "frame"
+    void Released(int frame);		// "frame" is free again
+
+    unsigned StartIO(int frame);	// the page in "frame" is being read
+					// or written; returns a stamp for
+    void EndIO(int frame, unsigned stamp);	// saying it's done
+    bool IsBusy(int frame);		// is the page being read or written?
+    ProcessAddrSpace *Sharer(int frame, int n);
+					// the "n"th address space using
+					// "frame", counting from 0, or NULL
+
+    void Age();				// shift the use bits into the ages
+					// (called at each timer interrupt)
+
+    char *PolicyName();			// "fifo", "random", ...
+
+    void RunCleaner();			// the page cleaner's loop
+
+  private:
+    ReplacementPolicy policy;
+    FrameInfo *frames;			// one per physical frame
+    unsigned numLoaded;			// pages brought in so far
+    int hand;				// for clock: the next frame to look at
+    unsigned int seed;			// for random: our own, so as not to
+					// disturb Random()
+    int numBusy;			// frames being read or written
+    int numWaiting;			// faults waiting for one to be done
+    Semaphore *ioDone;			// ... which wait on this
+    int cleanTarget;			// free frames and clean pages the
+					// page cleaner keeps ready
+    bool cleanerIdle;			// is it waiting on cleanerWakeup?
+    Semaphore *cleanerWakeup;
+
+    bool CanEvict(int frame);		// could the page in "frame" go?
+    bool LoadedLast(int frame, ProcessAddrSpace *space);
+					// is it the last page "space"
+					// brought in?
+    bool IsUsed(int frame);		// has it been used, by anyone?
+    bool IsDirty(int frame);		// has it changed?
+    void ClearUse(int frame);		// clear its use bits
+    int ChooseVictim();			// pick a frame to evict
+    bool EvictedBefore(int frame, int other);
+					// would the policy rather evict the
+					// page in "frame"?
+    void WaitForIO();			// wait until a busy frame isn't
+    void WakeCleaner();			// start the page cleaner going
+    int NextToClean(int taken);		// a frame for it to write out, or -1
+};
+
+#endif // FRAMETABLE_H
@@ -0,0 +1,216 @@
+// image.cc
+//	Routines to read the pages of a user program from its NOFF file,
+//	as the program touches them.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "image.h"
+#include "system.h"
+
+static thread_local ProgramImage *imagesInUse = NULL;
+					// every image, so that processes
+					// running the same program can
+					// share one
+
+//----------------------------------------------------------------------
+// ProgramImage::ProgramImage
+// 	Remember where a program's pages come from.  The address space
+//	that creates the image holds the first reference to it.
+//
+//	"file" -- the open NOFF file; the image now owns it
+//	"header" -- its header, already checked and byte-swapped
+//----------------------------------------------------------------------
+
+ProgramImage::ProgramImage(OpenFile *file, NoffHeader *header)
+{
+    executable = file;
+#ifdef FILESYS_STUB
+    executable->MapForReading();	// page faults copy from memory,
+					// with no system calls
+#endif
+    noffH = *header;
+    references = 1;
+    numCodePages = (noffH.code.virtualAddr + noffH.code.size) / PageSize;
+    codeFrames = new int[numCodePages];
+    for (int i = 0; i < numCodePages; i++)
+	codeFrames[i] = -1;
+    next = imagesInUse;
+    imagesInUse = this;
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::~ProgramImage
+// 	Close the program file.  Every address space that used the image
+//	is gone, and so are the frames of its code pages.
+//----------------------------------------------------------------------
+
+ProgramImage::~ProgramImage()
+{
+    ProgramImage **image;
+
+    for (image = &imagesInUse; *image != this; image = &(*image)->next)
+	ASSERT(*image != NULL);
+    *image = next;
+    for (int i = 0; i < numCodePages; i++)
+	ASSERT(codeFrames[i] == -1);
+    delete [] codeFrames;
+    delete executable;
+}
+
+//----------------------------------------------------------------------
+// FindProgramImage
+// 	Look for an image, in use by some address space, that is read
+//	from the same program file as "file".
+//
+//	Returns NULL if there is none.
+//----------------------------------------------------------------------
+
+ProgramImage *
+FindProgramImage(OpenFile *file)
+{
+    ProgramImage *image;
+
+    for (image = imagesInUse; image != NULL; image = image->next)
+	if (image->IsFile(file))
+	    return image;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::IsFile
+// 	Return TRUE if the image is read from the same file as "file".
+//----------------------------------------------------------------------
+
+bool
+ProgramImage::IsFile(OpenFile *file)
+{
+    return executable->SameFile(file);
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::AddReference, RemoveReference
+// 	Count the address spaces using the image, and get rid of it when
+//	the last one has been deleted.
+//----------------------------------------------------------------------
+
+void
+ProgramImage::AddReference()
+{
+    references++;
+}
+
+void
+ProgramImage::RemoveReference()
+{
+    ASSERT(references > 0);
+    if (--references == 0)
+	delete this;
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::ReadPage
+// 	Fill in one page of the address space, as it is before the
+//	program starts: the bytes of the code and initialized data
+//	segments that fall on the page, and zero everywhere else.
+//
+//	"vpn" -- the virtual page
+//	"into" -- where to put it, PageSize bytes
+//----------------------------------------------------------------------
+
+void
+ProgramImage::ReadPage(int vpn, char *into)
+{
+    bzero(into, PageSize);
+    ReadSegment(&noffH.code, vpn, into);
+    ReadSegment(&noffH.initData, vpn, into);
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::ReadSegment
+// 	Read the part of a segment that lies on page "vpn", if any.
+//----------------------------------------------------------------------
+
+void
+ProgramImage::ReadSegment(Segment *segment, int vpn, char *into)
+{
+    int pageStart = vpn * PageSize;
+    int start = segment->virtualAddr;
+    int end = segment->virtualAddr + segment->size;
+
+    if (start < pageStart)
+	start = pageStart;
+    if (end > pageStart + PageSize)
+	end = pageStart + PageSize;
+
+    if (start >= end)
+	return;
+    DEBUG('a', "Reading 0x%x to 0x%x from the program file\n", start, end);
+    executable->ReadAt(into + (start - pageStart), end - start,
+		       segment->inFileAddr + (start - segment->virtualAddr));
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::IsCode
+// 	Return TRUE if page "vpn" lies wholly within the code segment,
+//	so that it can be shared read-only by every process running the
+//	program.  The page where the code ends usually has data on it
+//	too, which each process needs its own copy of.
+//----------------------------------------------------------------------
+
+bool
+ProgramImage::IsCode(int vpn)
+{
+    int pageStart = vpn * PageSize;
+
+    return (vpn < numCodePages) && (pageStart >= noffH.code.virtualAddr)
+	&& !Overlaps(&noffH.initData, vpn)
+	&& !Overlaps(&noffH.uninitData, vpn);
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::CodeFrame, SetCodeFrame, ForgetCodeFrame
+// 	Keep track of which frame holds each code page, as read from the
+//	program file.  A frame is forgotten when it is freed or evicted,
+//	or when the process using it is about to write to it.
+//
+//	"vpn" -- the code page
+//	"frame" -- the frame holding it
+//----------------------------------------------------------------------
+
+int
+ProgramImage::CodeFrame(int vpn)
+{
+    ASSERT(IsCode(vpn));
+    return codeFrames[vpn];
+}
+
+void
+ProgramImage::SetCodeFrame(int vpn, int frame)
+{
+    ASSERT(IsCode(vpn) && (codeFrames[vpn] == -1));
+    codeFrames[vpn] = frame;
+}
+
+void
+ProgramImage::ForgetCodeFrame(int vpn, int frame)
+{
+    if ((vpn < numCodePages) && (codeFrames[vpn] == frame))
+	codeFrames[vpn] = -1;
+}
+
+//----------------------------------------------------------------------
+// ProgramImage::Overlaps
+// 	Return TRUE if any of "segment" lies on page "vpn".
+//----------------------------------------------------------------------
+
+bool
+ProgramImage::Overlaps(Segment *segment, int vpn)
+{
+    int pageStart = vpn * PageSize;
+
+    return (segment->size > 0) && (segment->virtualAddr < pageStart + PageSize)
+	&& (segment->virtualAddr + segment->size > pageStart);
+}
@@ -0,0 +1,85 @@
+// image.h
+//	Data structures for the program file that a demand-paged address
+//	space loads its pages from.
+//
+//	In the vm build, an address space starts out with nothing in
+//	memory.  The first time the program touches a page, the page
+//	fault handler asks the program's image for the page: the part of
+//	it covered by the code and initialized data segments is read from
+//	the NOFF file, and the rest (uninitialized data and stack) is
+//	zero.  With the stub file system, the file is mapped into the
+//	host's memory when the image is created, so that a page fault
+//	makes no system calls.  A forked child shares its parent's image,
+//	so the file stays open until the last process using it is gone.
+//
+//	Processes running the same program share one image too, and with
+//	it the frames of their code pages: those that hold nothing but
+//	code.  Such a page is mapped read-only, and the image remembers
+//	the frame it was read into, so that the next process to touch the
+//	page maps the same frame rather than reading its own copy.  A
+//	process that writes to a code page gets a private copy, as after
+//	a fork (see ProcessAddrSpace::CopyOnWrite).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "copyright.h"
+#include "filesys.h"
+#include "noff.h"
+
+// The following class defines a program file, as used by the address
+// spaces that have been loaded from it.
+
+class ProgramImage {
+  public:
+    ProgramImage(OpenFile *file, NoffHeader *header);
+					// page in from "file", laid out
+					// as "header" says; the image
+					// closes the file when it goes
+
+    bool IsFile(OpenFile *file);	// is the image read from "file"?
+
+    void AddReference();		// one more address space uses it
+    void RemoveReference();		// one fewer; deletes the image
+					// when none are left
+
+    void ReadPage(int vpn, char *into);	// fill in virtual page "vpn"
+					// (PageSize bytes at "into")
+
+    bool IsCode(int vpn);		// does page "vpn" hold only code?
+    int CodeFrame(int vpn);		// the frame holding code page "vpn",
+					// or -1 if it isn't in memory
+    void SetCodeFrame(int vpn, int frame);
+					// code page "vpn" is now in "frame"
+    void ForgetCodeFrame(int vpn, int frame);
+					// "frame" no longer holds code page
+					// "vpn", as read from the file
+
+    ProgramImage *next;			// the next image in use, for
+					// FindProgramImage
+
+  private:
+    ~ProgramImage();			// only RemoveReference deletes it
+
+    OpenFile *executable;		// the NOFF file
+    NoffHeader noffH;			// where its segments go
+    int references;			// address spaces using it
+    int numCodePages;			// pages that hold only code
+    int *codeFrames;			// the frame holding each, or -1
+
+    void ReadSegment(Segment *segment, int vpn, char *into);
+					// copy in the part of "segment"
+					// on page "vpn", if any
+    bool Overlaps(Segment *segment, int vpn);
+					// does "segment" lie on page "vpn"?
+};
+
+extern ProgramImage *FindProgramImage(OpenFile *file);
+					// the image in use read from "file",
+					// or NULL if there isn't one
+
+#endif // IMAGE_H
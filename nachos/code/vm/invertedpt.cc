@@ -0,0 +1,163 @@
+// invertedpt.cc
+//	Routines to look up, add and remove the pages in memory in the
+//	inverted page table.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "invertedpt.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// InvertedPageTable::InvertedPageTable
+// 	Set up an empty table.  The anchor table is the smallest power
+//	of 2 that has a chain for each entry, so that the chains are
+//	short until frames start to be shared.
+//
+//	"size" -- the number of entries to allocate at first, and each
+//		time more are needed: the number of frames
+//----------------------------------------------------------------------
+
+InvertedPageTable::InvertedPageTable(int size)
+{
+    for (numAnchors = 1; numAnchors < size; numAnchors *= 2)
+	;
+    anchors = new InvertedEntry *[numAnchors];
+    for (int i = 0; i < numAnchors; i++)
+	anchors[i] = NULL;
+    freeEntries = NULL;
+    blockSize = size;
+    blocks = new List;
+    stats->pageTableBytes = numAnchors * sizeof(InvertedEntry *);
+    Grow();
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::~InvertedPageTable
+// 	De-allocate the table.
+//----------------------------------------------------------------------
+
+InvertedPageTable::~InvertedPageTable()
+{
+    while (!blocks->IsEmpty())
+	delete [] (InvertedEntry *) blocks->Remove();
+    delete blocks;
+    delete [] anchors;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Lookup
+// 	Find the entry for a page, if the page is in memory.
+//
+//	"asid" -- the address space's ID
+//	"vpn" -- the virtual page
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedPageTable::Lookup(int asid, int vpn)
+{
+    InvertedEntry *e;
+
+    stats->numPageTableLookups++;
+    stats->numPageTableProbes++;		// the anchor
+    for (e = anchors[Hash(asid, vpn)]; e != NULL; e = e->next) {
+	stats->numPageTableProbes++;
+	if ((e->asid == asid) && (e->entry.virtualPage == vpn))
+	    return &e->entry;
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Insert
+// 	Add an entry for a page that has just been brought into memory,
+//	or that has started sharing a frame.  The caller fills it in.
+//
+//	"asid" -- the address space's ID
+//	"vpn" -- the virtual page
+//----------------------------------------------------------------------
+
+TranslationEntry *
+InvertedPageTable::Insert(int asid, int vpn)
+{
+    InvertedEntry *e;
+    int chain = Hash(asid, vpn);
+
+    if (freeEntries == NULL)
+	Grow();
+    e = freeEntries;
+    freeEntries = e->next;
+    e->asid = asid;
+    e->entry.virtualPage = vpn;
+    e->next = anchors[chain];
+    anchors[chain] = e;
+
+    stats->pageTableEntries++;
+    if (stats->pageTableEntries > stats->maxPageTableEntries)
+	stats->maxPageTableEntries = stats->pageTableEntries;
+    return &e->entry;
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Remove
+// 	Take out the entry for a page that has left memory, or whose
+//	address space is going away.
+//
+//	"asid" -- the address space's ID
+//	"vpn" -- the virtual page
+//----------------------------------------------------------------------
+
+void
+InvertedPageTable::Remove(int asid, int vpn)
+{
+    InvertedEntry **link, *e;
+
+    for (link = &anchors[Hash(asid, vpn)]; *link != NULL;
+						link = &(*link)->next) {
+	e = *link;
+	if ((e->asid == asid) && (e->entry.virtualPage == vpn)) {
+	    *link = e->next;
+	    e->next = freeEntries;
+	    freeEntries = e;
+	    stats->pageTableEntries--;
+	    return;
+	}
+    }
+    ASSERT(FALSE);			// the page wasn't in the table
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Hash
+// 	Return the chain that a page's entry goes on.  Address spaces
+//	tend to use the same low page numbers, so the ID is spread out
+//	before it is mixed in (as in Machine::TLBSet).
+//----------------------------------------------------------------------
+
+int
+InvertedPageTable::Hash(int asid, int vpn)
+{
+    return (vpn ^ (asid * 2654435761u)) & (numAnchors - 1);
+}
+
+//----------------------------------------------------------------------
+// InvertedPageTable::Grow
+// 	Allocate another block of entries, and put them on the free list.
+//	Called when there are more entries in use than frames, because
+//	frames are shared.
+//----------------------------------------------------------------------
+
+void
+InvertedPageTable::Grow()
+{
+    InvertedEntry *block = new InvertedEntry[blockSize];
+
+    DEBUG('a', "Inverted page table: %d more entries\n", blockSize);
+    for (int i = 0; i < blockSize; i++) {
+	block[i].next = freeEntries;
+	freeEntries = &block[i];
+    }
+    blocks->Append(block);
+    stats->pageTableBytes += blockSize * sizeof(InvertedEntry);
+}
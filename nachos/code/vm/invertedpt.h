@@ -0,0 +1,77 @@
+// invertedpt.h
+//	Data structures for the inverted page table, an alternative to a
+//	linear page table for each address space, used when the vm build
+//	is compiled with INVERTED_PAGE_TABLE (see vm/Makefile).
+//
+//	A linear page table has an entry for every page of the address
+//	space, whether it is in memory or not, and so grows with the size
+//	of the address space.  The inverted page table is shared by every
+//	address space, and only has entries for the pages that are in
+//	memory: one for each frame, and one more for each extra address
+//	space sharing a frame after a fork, or running the same program.
+//	Its size goes with the size of main memory instead.
+//
+//	An entry is found by hashing the address space's ID and the
+//	virtual page number into the hash anchor table, which holds the
+//	first entry in each chain of entries with the same hash.  A lookup
+//	costs a probe of the anchor and one for each entry in the chain up
+//	to the one wanted, where a linear table needs a single probe; the
+//	anchor table has at least as many chains as there are frames, to
+//	keep the chains short.
+//
+//	The machine never sees the table: it requires USE_TLB, and pages
+//	are looked up in it when they miss in the TLB.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef INVERTEDPT_H
+#define INVERTEDPT_H
+
+#include "copyright.h"
+#include "translate.h"
+#include "list.h"
+
+// One entry of the inverted page table: a page of an address space
+// that is in memory.
+
+class InvertedEntry {
+  public:
+    TranslationEntry entry;		// where the page is, and its use,
+					// dirty and read-only bits
+    int asid;				// whose page it is
+    InvertedEntry *next;		// the next entry with the same hash,
+					// or the next free entry
+};
+
+// The following class defines the inverted page table.
+
+class InvertedPageTable {
+  public:
+    InvertedPageTable(int size);	// an empty table, with room for
+					// "size" entries to start with
+    ~InvertedPageTable();
+
+    TranslationEntry *Lookup(int asid, int vpn);
+					// the entry for page "vpn" of address
+					// space "asid", or NULL if it isn't
+					// in memory
+    TranslationEntry *Insert(int asid, int vpn);
+					// add an entry for the page, which
+					// mustn't have one
+    void Remove(int asid, int vpn);	// and take it out again
+
+  private:
+    InvertedEntry **anchors;		// the hash anchor table: the first
+					// entry of each chain, or NULL
+    int numAnchors;			// a power of 2
+    InvertedEntry *freeEntries;		// entries not in use
+    int blockSize;			// entries are allocated this many
+    List *blocks;			// at a time, and never move
+
+    int Hash(int asid, int vpn);	// which chain the page is on
+    void Grow();			// allocate another block of entries
+};
+
+#endif // INVERTEDPT_H
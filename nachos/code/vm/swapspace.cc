@@ -0,0 +1,248 @@
+// swapspace.cc
+//	Routines to allocate the slots of the swap area, and to read pages
+//	from it and write them to it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "swapspace.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Set up the swap area, with every slot free, on a new disk.
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace()
+{
+    char *name = TemporaryName("nachos-swap");
+
+    disk = new SynchDisk(name);
+    Unlink(name);			// it stays open until Nachos exits
+    delete [] name;
+
+    sectorsPerSlot = (PageSize > SectorSize) ? PageSize / SectorSize : 1;
+    slotsPerTrack = SectorsPerTrack / sectorsPerSlot;
+    if (slotsPerTrack == 0)
+	slotsPerTrack = 1;
+    numSlots = NumSectors / sectorsPerSlot;
+    references = new int[numSlots];
+    writes = new int[numSlots];
+    for (int i = 0; i < numSlots; i++)
+	references[i] = writes[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	De-allocate the swap area, and its disk.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    delete disk;
+    delete [] references;
+    delete [] writes;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate
+// 	Find "count" free slots in a row, and give them to the caller.
+//	A run that fits on one track is taken if there is one; otherwise
+//	the first run big enough.
+//
+//	Returns the first slot, or -1 if there is no run that long.
+//
+//	"count" -- the number of slots needed
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate(int count)
+{
+    int first = -1;
+
+    for (int i = 0; (i + count <= numSlots) && (first == -1); i++)
+	if (((i % slotsPerTrack) + count <= slotsPerTrack) && IsFree(i, count))
+	    first = i;
+    for (int i = 0; (i + count <= numSlots) && (first == -1); i++)
+	if (IsFree(i, count))
+	    first = i;
+    if (first == -1)
+	return -1;
+    for (int i = first; i < first + count; i++)
+	references[i] = 1;
+    return first;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::IsFree
+// 	Return TRUE if "count" slots from "first" on are free: no backing
+//	store uses them, and no write to them is still in progress.
+//----------------------------------------------------------------------
+
+bool
+SwapSpace::IsFree(int first, int count)
+{
+    for (int i = first; i < first + count; i++)
+	if ((references[i] > 0) || (writes[i] > 0))
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::AddReference, Release, IsShared
+// 	Count the backing stores using a slot.  A slot that none uses is
+//	free once any write to it is over.
+//
+//	"slot" -- the slot, which a backing store uses
+//----------------------------------------------------------------------
+
+void
+SwapSpace::AddReference(int slot)
+{
+    ASSERT(references[slot] > 0);
+    references[slot]++;
+}
+
+void
+SwapSpace::Release(int slot)
+{
+    ASSERT(references[slot] > 0);
+    references[slot]--;
+}
+
+bool
+SwapSpace::IsShared(int slot)
+{
+    return references[slot] > 1;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Read
+// 	Read the page in a slot, waiting for the disk.  A page smaller
+//	than a sector is read into a sector of its own, and copied out.
+//
+//	"slot" -- the slot, which must have been written
+//	"into" -- PageSize bytes of memory
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Read(int slot, char *into)
+{
+    int *sectors = new int[sectorsPerSlot];
+    char **data = new char *[sectorsPerSlot];
+    char sector[SectorSize];
+
+    ASSERT(references[slot] > 0);
+    stats->numSwapReads++;
+    for (int i = 0; i < sectorsPerSlot; i++) {
+	sectors[i] = slot * sectorsPerSlot + i;
+	data[i] = (PageSize < SectorSize) ? sector : into + i * SectorSize;
+    }
+    Transfer(sectors, data, sectorsPerSlot, FALSE);
+    if (PageSize < SectorSize)
+	bcopy(sector, into, PageSize);
+    delete [] sectors;
+    delete [] data;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Write
+// 	Write a cluster of pages out to their slots, waiting for the
+//	disk.  A page smaller than a sector is padded out to one.
+//
+//	The pages are copied to the disk as their sectors are sent to it,
+//	so the caller must have cleared their dirty bits first: a page
+//	changed in the meantime is written out again later.  The caller's
+//	address space may be gone by the time Write returns.
+//
+//	"slots" -- the slot for each page
+//	"pages" -- where each page is, in mainMemory
+//	"count" -- the number of pages, at most MaxCluster
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Write(int *slots, char **pages, int count)
+{
+    int numSectors = count * sectorsPerSlot;
+    int *sectors = new int[numSectors];
+    char **data = new char *[numSectors];
+    char *padded = NULL;
+    int i, j, n;
+
+    ASSERT((count > 0) && (count <= MaxCluster));
+    if (PageSize < SectorSize) {
+	padded = new char[count * SectorSize];
+	bzero(padded, count * SectorSize);
+    }
+    for (i = 0, n = 0; i < count; i++) {
+	ASSERT(references[slots[i]] > 0);
+	writes[slots[i]]++;
+	if (padded != NULL)
+	    bcopy(pages[i], padded + i * SectorSize, PageSize);
+	for (j = 0; j < sectorsPerSlot; j++, n++) {
+	    sectors[n] = slots[i] * sectorsPerSlot + j;
+	    data[n] = (padded != NULL) ? padded + i * SectorSize
+				       : pages[i] + j * SectorSize;
+	}
+    }
+    stats->numSwapClusters++;
+    stats->numDirtyWritebacks += count;
+    Transfer(sectors, data, numSectors, TRUE);
+    for (i = 0; i < count; i++)
+	writes[slots[i]]--;
+    if (padded != NULL)
+	delete [] padded;
+    delete [] sectors;
+    delete [] data;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Prefer
+// 	Let a thread have the swap disk ahead of the others waiting for
+//	it, one sector at a time: see SynchDisk::Prefer.
+//
+//	"thread" -- the thread to prefer
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Prefer(NachOSThread *thread)
+{
+    disk->Prefer(thread);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Transfer
+// 	Read or write some sectors, sending the disk whichever it can get
+//	to soonest each time, rather than going in order (see
+//	swapspace.h).  The arrays are reordered as the sectors are done.
+//
+//	"sectors" -- the sectors
+//	"data" -- SectorSize bytes of memory for each
+//	"count" -- the number of sectors
+//	"writing" -- TRUE to write them, FALSE to read them
+//----------------------------------------------------------------------
+
+void
+SwapSpace::Transfer(int *sectors, char **data, int count, bool writing)
+{
+    int soonest, sector;
+    char *buffer;
+
+    for (; count > 0; count--) {
+	soonest = 0;
+	for (int i = 1; i < count; i++)
+	    if (disk->Latency(sectors[i], writing)
+				< disk->Latency(sectors[soonest], writing))
+		soonest = i;
+	sector = sectors[soonest];
+	buffer = data[soonest];
+	sectors[soonest] = sectors[count - 1];
+	data[soonest] = data[count - 1];
+	if (writing)
+	    disk->WriteSector(sector, buffer);
+	else
+	    disk->ReadSector(sector, buffer);
+    }
+}
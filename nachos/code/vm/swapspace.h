@@ -0,0 +1,76 @@
+// swapspace.h
+//	Data structures for the swap area of the vm build: the disk space
+//	where the backing stores of the address spaces keep the pages
+//	they have written out.
+//
+//	The swap area has a simulated disk of its own (see disk.h), kept
+//	in a scratch host file that goes away when Nachos does: the vm
+//	build has no Nachos disk, and the file system's is too small to
+//	share.  It is divided into slots of a page each (or of a sector,
+//	if pages are smaller than that), read and written through
+//	SynchDisk, so the thread asking waits for the disk and others run
+//	in the meantime.
+//
+//	After a fork, the parent and child share the slots of the pages
+//	that the parent had written out, until one of them writes the
+//	page out again; and a page in a frame that several address spaces
+//	share is written out once, to a slot they all use.  A slot isn't
+//	reused until no backing store uses it and no write to it is in
+//	progress: a write started for a process that has since exited
+//	mustn't land on another's page.
+//
+//	Pages are written out in clusters.  Write takes the pages being
+//	cleaned together, and sends their sectors to the disk in order of
+//	whichever the disk can reach soonest, rather than in order of
+//	sector number: a request always arrives a little after the head
+//	has passed the end of the sector before, so writing the next
+//	sector along would cost a whole turn of the disk.  Allocate puts a
+//	cluster's new slots in a row on one track if it can, so that the
+//	cluster goes out without seeks, and the pages come back in from
+//	the disk's track buffer when they are faulted in together.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAPSPACE_H
+#define SWAPSPACE_H
+
+#include "copyright.h"
+#include "synchdisk.h"
+
+#define MaxCluster	8	// the most pages written out at once
+
+// The following class defines the swap area.
+
+class SwapSpace {
+  public:
+    SwapSpace();			// an empty swap area, on a new disk
+    ~SwapSpace();
+
+    int Allocate(int count);		// "count" free slots in a row; returns
+					// the first, or -1 if there is no room
+    void AddReference(int slot);	// another backing store shares "slot"
+    void Release(int slot);		// a backing store is done with "slot"
+    bool IsShared(int slot);		// is "slot" used by more than one?
+
+    void Read(int slot, char *into);	// read the page in "slot"
+    void Write(int *slots, char **pages, int count);
+					// write "count" pages to their slots
+    void Prefer(NachOSThread *thread);	// let "thread" have the disk next
+
+  private:
+    SynchDisk *disk;
+    int sectorsPerSlot;			// at least one
+    int slotsPerTrack;			// or 1, if a slot takes several tracks
+    int numSlots;
+    int *references;			// backing stores using each slot
+    int *writes;			// writes to each slot in progress
+
+    bool IsFree(int first, int count);	// are the slots all free?
+    void Transfer(int *sectors, char **data, int count, bool writing);
+					// read or write the sectors, soonest
+					// first
+};
+
+#endif // SWAPSPACE_H